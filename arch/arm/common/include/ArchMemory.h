@@ -42,6 +42,103 @@ public:
  */
   void unmapPage(uint32 virtual_page);
 
+/**
+ * returns the physical page a virtual page of this address space is mapped to
+ *
+ * @param virtual_page the virtual page to look up
+ * @return the physical page number, 0 if the virtual page is not mapped
+ */
+  uint32 getMappedPPN(uint32 virtual_page);
+
+/**
+ * changes the writeable flag of an existing 4 KiB mapping
+ *
+ * @param virtual_page the mapped virtual page
+ * @param writeable 1 to allow writes, 0 for a read-only mapping
+ */
+  void setPageWriteable(uint32 virtual_page, uint32 writeable);
+
+/**
+ * @param virtual_page the mapped virtual page
+ * @return the writeable flag of an existing 4 KiB mapping
+ */
+  uint32 isPageWriteable(uint32 virtual_page);
+
+/**
+ * checks whether a mapped page has been written to and resets its dirty flag.
+ * The short page table format has no dirty flag, so every writeable page is
+ * reported as written to.
+ *
+ * @param virtual_page the mapped virtual page
+ * @return true if the page may have been written to since the last call
+ */
+  bool testAndClearDirty(uint32 virtual_page);
+
+/**
+ * checks whether a mapped page has been accessed and resets its accessed flag
+ *
+ * @param virtual_page the mapped virtual page
+ * @return true if the page was accessed since the last call
+ */
+  bool testAndClearAccessed(uint32 virtual_page);
+
+/**
+ * replaces the mapping of a virtual page by a reference to a swap slot, the
+ * physical page is not freed
+ *
+ * @param virtual_page the mapped virtual page
+ * @param swap_slot the swap slot holding the content of the page, must not be 0
+ */
+  void setPageSwapped(uint32 virtual_page, uint32 swap_slot);
+
+/**
+ * returns the swap slot of a swapped out virtual page
+ *
+ * @param virtual_page the virtual page
+ * @return the swap slot, 0 if the page is not swapped out
+ */
+  uint32 getSwapSlot(uint32 virtual_page);
+
+/**
+ * removes the reference to a swap slot from a swapped out virtual page
+ *
+ * @param virtual_page the swapped out virtual page
+ */
+  void clearSwapSlot(uint32 virtual_page);
+
+/**
+ * maps a range of virtual pages, the page tables are looked up (and allocated
+ * if missing) once per page table instead of once per page
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages to map
+ * @param physical_pages the physical pages, one per virtual page
+ * @param user_access PTE User/Supervisor Flag
+ * @return the number of pages mapped, mapping stops at the first page which is
+ * mapped or swapped out already, the physical pages behind it are left to the caller
+ */
+  size_t mapRange(uint32 virtual_page, size_t num_pages, const size_t* physical_pages, uint32 user_access);
+
+/**
+ * unmaps and frees all mapped pages of a range and removes empty page tables,
+ * swapped out pages are left alone.
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages
+ * @return the number of pages unmapped
+ */
+  size_t unmapRange(uint32 virtual_page, size_t num_pages);
+
+/**
+ * changes the writeable flag of all mapped pages of a range
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages
+ * @param writeable 1 to allow writes, 0 for read-only mappings
+ * @return the number of pages changed
+ */
+  size_t protectRange(uint32 virtual_page, size_t num_pages, uint32 writeable);
+
 /**
  * Destructor. Recursively deletes the page directory and all page tables
  *
@@ -92,6 +189,15 @@ public:
    */
     static void mapKernelPage(uint32 virtual_page, uint32 physical_page);
 
+  /**
+   * maps a range of virtual pages in kernel mapping, the page tables have to exist
+   *
+   * @param virtual_page the first virtual page
+   * @param num_pages the number of pages to map
+   * @param physical_pages the physical pages, one per virtual page
+   */
+    static void mapKernelRange(uint32 virtual_page, size_t num_pages, const size_t* physical_pages);
+
   /**
    * removes the mapping to a virtual_page by marking its PTE Entry as non valid
    * in kernel mapping
@@ -110,8 +216,22 @@ public:
   static const size_t RESERVED_START = 0x80000ULL;
   static const size_t RESERVED_END = 0x80400ULL;
 
+  /**
+   * virtual pages of the kernel stacks, the last 4 MiB covered by the kernel page tables
+   * (the kernel heap ends where they start)
+   */
+  static const size_t KERNEL_STACKS_START = 0x80C00ULL;
+  static const size_t KERNEL_STACKS_END = 0x81000ULL;
+
 private:
 
+/**
+ * returns the page table entry of a virtual page or 0 if there is no page table for it
+ *
+ * @param virtual_page the virtual page
+ */
+  PageTableEntry* getPTE(uint32 virtual_page);
+
 /** 
  * Adds a page directory entry to the given page directory.
  * (In other words, adds the reference to a new page table to a given
@@ -17,6 +17,9 @@
 #define PDE_SIZE_PT 1
 #define PDE_SIZE_PAGE 2
 
+// marks a fault pte (size 0) whose page_ppn holds a swap slot
+#define PTE_SWAPPED 1
+
 #define PHYS_OFFSET_4K (LOAD_BASE / PAGE_SIZE)
 #define PHYS_OFFSET_1M (PHYS_OFFSET_4K / PAGE_TABLE_ENTRIES)
 
@@ -47,7 +50,7 @@ void ArchMemory::checkAndRemovePT(uint32 pde_vpn)
     return; // PT not present -> do nothing.
 
   for (uint32 pte_vpn = 0; pte_vpn < PAGE_TABLE_ENTRIES; ++pte_vpn)
-    if (pte_base[pte_vpn].size == 2)
+    if (pte_base[pte_vpn].size == 2 || pte_base[pte_vpn].reserved == PTE_SWAPPED)
       return; //not empty -> do nothing
 
   //else:
@@ -81,6 +84,162 @@ void ArchMemory::unmapPage(uint32 virtual_page)
   }
 }
 
+PageTableEntry* ArchMemory::getPTE(uint32 virtual_page)
+{
+  PageDirEntry *page_directory = (PageDirEntry *) getIdentAddressOfPPN(page_dir_page_);
+  uint32 pde_vpn = virtual_page / PAGE_TABLE_ENTRIES;
+  uint32 pte_vpn = virtual_page % PAGE_TABLE_ENTRIES;
+  if (page_directory[pde_vpn].pt.size != PDE_SIZE_PT)
+    return 0;
+  PageTableEntry *pte_base = ((PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.pt_ppn - PHYS_OFFSET_4K)) + page_directory[pde_vpn].pt.offset * PAGE_TABLE_ENTRIES;
+  return pte_base + pte_vpn;
+}
+
+uint32 ArchMemory::getMappedPPN(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  if (!pte || pte->size != 2)
+    return 0;
+  return pte->page_ppn - PHYS_OFFSET_4K;
+}
+
+void ArchMemory::setPageWriteable(uint32 virtual_page, uint32 writeable)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->size == 2);
+  pte->permissions = writeable ? 3 : 2;
+}
+
+uint32 ArchMemory::isPageWriteable(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->size == 2);
+  return pte->permissions == 3;
+}
+
+bool ArchMemory::testAndClearDirty(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  return pte && pte->size == 2 && pte->permissions == 3;
+}
+
+bool ArchMemory::testAndClearAccessed(uint32 /*virtual_page*/)
+{
+  // there is no accessed flag in the short descriptor format,
+  // page replacement degrades to FIFO
+  return false;
+}
+
+void ArchMemory::setPageSwapped(uint32 virtual_page, uint32 swap_slot)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->size == 2 && swap_slot);
+  pte->size = 0;
+  pte->reserved = PTE_SWAPPED;
+  pte->page_ppn = swap_slot;
+}
+
+uint32 ArchMemory::getSwapSlot(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  if (!pte || pte->size != 0 || pte->reserved != PTE_SWAPPED)
+    return 0;
+  return pte->page_ppn;
+}
+
+void ArchMemory::clearSwapSlot(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->size == 0 && pte->reserved == PTE_SWAPPED);
+  pte->reserved = 0;
+  pte->page_ppn = 0;
+  checkAndRemovePT(virtual_page / PAGE_TABLE_ENTRIES);
+}
+
+size_t ArchMemory::mapRange(uint32 virtual_page, size_t num_pages, const size_t* physical_pages, uint32 user_access)
+{
+  PageDirEntry *page_directory = (PageDirEntry *) getIdentAddressOfPPN(page_dir_page_);
+  size_t mapped = 0;
+  while (mapped < num_pages)
+  {
+    uint32 pde_vpn = (virtual_page + mapped) / PAGE_TABLE_ENTRIES;
+    if (page_directory[pde_vpn].pt.size == PDE_SIZE_NONE)
+      insertPT(pde_vpn);
+    assert(page_directory[pde_vpn].pt.size == PDE_SIZE_PT); // currently only 4K pages for the userspace
+
+    PageTableEntry *pte_base = ((PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.pt_ppn - PHYS_OFFSET_4K)) + page_directory[pde_vpn].pt.offset * PAGE_TABLE_ENTRIES;
+    for (uint32 pte_vpn = (virtual_page + mapped) % PAGE_TABLE_ENTRIES; pte_vpn < PAGE_TABLE_ENTRIES && mapped < num_pages;
+         ++pte_vpn, ++mapped)
+    {
+      if (pte_base[pte_vpn].size == 2 || pte_base[pte_vpn].reserved == PTE_SWAPPED)
+        return mapped;
+      pte_base[pte_vpn].bufferable = 0;
+      pte_base[pte_vpn].cachable = 0;
+      pte_base[pte_vpn].permissions = user_access ? 3 : 1;
+      pte_base[pte_vpn].reserved = 0;
+      pte_base[pte_vpn].page_ppn = physical_pages[mapped] + PHYS_OFFSET_4K;
+      pte_base[pte_vpn].size = 2;
+    }
+  }
+  return mapped;
+}
+
+size_t ArchMemory::unmapRange(uint32 virtual_page, size_t num_pages)
+{
+  PageDirEntry *page_directory = (PageDirEntry *) getIdentAddressOfPPN(page_dir_page_);
+  size_t num_unmapped = 0;
+  size_t done = 0;
+  while (done < num_pages)
+  {
+    uint32 pde_vpn = (virtual_page + done) / PAGE_TABLE_ENTRIES;
+    uint32 pte_vpn = (virtual_page + done) % PAGE_TABLE_ENTRIES;
+    size_t count = Min(num_pages - done, PAGE_TABLE_ENTRIES - pte_vpn);
+    done += count;
+    if (page_directory[pde_vpn].pt.size != PDE_SIZE_PT)
+      continue;
+
+    PageTableEntry *pte_base = ((PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.pt_ppn - PHYS_OFFSET_4K)) + page_directory[pde_vpn].pt.offset * PAGE_TABLE_ENTRIES;
+    for (; count > 0; --count, ++pte_vpn)
+    {
+      if (pte_base[pte_vpn].size != 2)
+        continue;
+      pte_base[pte_vpn].size = 0;
+      PageManager::instance()->freePPN(pte_base[pte_vpn].page_ppn - PHYS_OFFSET_4K);
+      ++num_unmapped;
+    }
+    checkAndRemovePT(pde_vpn);
+  }
+  return num_unmapped;
+}
+
+size_t ArchMemory::protectRange(uint32 virtual_page, size_t num_pages, uint32 writeable)
+{
+  PageDirEntry *page_directory = (PageDirEntry *) getIdentAddressOfPPN(page_dir_page_);
+  size_t num_changed = 0;
+  size_t done = 0;
+  while (done < num_pages)
+  {
+    uint32 pde_vpn = (virtual_page + done) / PAGE_TABLE_ENTRIES;
+    uint32 pte_vpn = (virtual_page + done) % PAGE_TABLE_ENTRIES;
+    size_t count = Min(num_pages - done, PAGE_TABLE_ENTRIES - pte_vpn);
+    done += count;
+    if (page_directory[pde_vpn].pt.size != PDE_SIZE_PT)
+      continue;
+
+    PageTableEntry *pte_base = ((PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.pt_ppn - PHYS_OFFSET_4K)) + page_directory[pde_vpn].pt.offset * PAGE_TABLE_ENTRIES;
+    for (; count > 0; --count, ++pte_vpn)
+    {
+      uint32 permissions = writeable ? 3 : 2;
+      if (pte_base[pte_vpn].size == 2 && pte_base[pte_vpn].permissions != permissions)
+      {
+        pte_base[pte_vpn].permissions = permissions;
+        ++num_changed;
+      }
+    }
+  }
+  return num_changed;
+}
+
 void ArchMemory::insertPT(uint32 pde_vpn)
 {
   PageDirEntry *page_directory = (PageDirEntry *) getIdentAddressOfPPN(page_dir_page_);
@@ -226,6 +385,26 @@ void ArchMemory::mapKernelPage(uint32 virtual_page, uint32 physical_page)
   pte_base[pte_vpn].size = 2;
 }
 
+void ArchMemory::mapKernelRange(uint32 virtual_page, size_t num_pages, const size_t* physical_pages)
+{
+  PageDirEntry *page_directory = kernel_page_directory;
+  size_t mapped = 0;
+  while (mapped < num_pages)
+  {
+    uint32 pde_vpn = (virtual_page + mapped) / PAGE_TABLE_ENTRIES;
+    assert(page_directory[pde_vpn].page.size == PDE_SIZE_PT);
+    PageTableEntry *pte_base = ((PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.pt_ppn - PHYS_OFFSET_4K)) + page_directory[pde_vpn].pt.offset * PAGE_TABLE_ENTRIES;
+    for (uint32 pte_vpn = (virtual_page + mapped) % PAGE_TABLE_ENTRIES; pte_vpn < PAGE_TABLE_ENTRIES && mapped < num_pages;
+         ++pte_vpn, ++mapped)
+    {
+      assert(pte_base[pte_vpn].size == 0);
+      pte_base[pte_vpn].permissions = 1;
+      pte_base[pte_vpn].page_ppn = physical_pages[mapped] + PHYS_OFFSET_4K;
+      pte_base[pte_vpn].size = 2;
+    }
+  }
+}
+
 void ArchMemory::unmapKernelPage(uint32 virtual_page)
 {
   PageDirEntry *page_directory = kernel_page_directory;
@@ -236,6 +415,7 @@ void ArchMemory::unmapKernelPage(uint32 virtual_page)
   assert(pte_base[pte_vpn].size == 2);
   pte_base[pte_vpn].size = 0;
   pte_base[pte_vpn].permissions = 0;
+  asm("mcr p15, 0, %[v], c8, c7, 1\n" : : [v]"r"(virtual_page * PAGE_SIZE)); // invalidate tlb entry
   PageManager::instance()->freePPN(pte_base[pte_vpn].page_ppn - PHYS_OFFSET_4K);
 }
 
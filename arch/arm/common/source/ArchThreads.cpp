@@ -9,6 +9,7 @@
 #include "paging-definitions.h"
 #include "offsets.h"
 #include "Thread.h"
+#include "ThreadCache.h"
 #include "Scheduler.h"
 #include "SpinLock.h"
 
@@ -35,7 +36,7 @@ void ArchThreads::setAddressSpace(Thread *thread, ArchMemory& arch_memory)
 
 void ArchThreads::createThreadInfosKernelThread(ArchThreadInfo *&info, pointer start_function, pointer stack)
 {
-  info = (ArchThreadInfo*)new uint8[sizeof(ArchThreadInfo)];
+  info = ThreadCache::instance()->allocThreadInfo();
   memset((void*)info, 0, sizeof(ArchThreadInfo));
   pointer pageDirectory = VIRTUAL_TO_PHYSICAL_BOOT(((pointer)kernel_page_directory));
   assert((pageDirectory) != 0);
@@ -59,7 +60,7 @@ void ArchThreads::changeInstructionPointer(ArchThreadInfo *info, pointer functio
 
 void ArchThreads::createThreadInfosUserspaceThread(ArchThreadInfo *&info, pointer start_function, pointer user_stack, pointer kernel_stack)
 {
-  info = (ArchThreadInfo*)new uint8[sizeof(ArchThreadInfo)];
+  info = ThreadCache::instance()->allocThreadInfo();
   memset((void*)info, 0, sizeof(ArchThreadInfo));
   pointer pageDirectory = VIRTUAL_TO_PHYSICAL_BOOT(((pointer)kernel_page_directory));
   assert((pageDirectory) != 0);
@@ -75,11 +75,10 @@ void pageFaultHandler(uint32 address, uint32 type)
   if (currentThread->loader_)
   {
     //lets hope this Exeption wasn't thrown during a TaskSwitch
-    if (address > 8U*1024U*1024U && address < 2U*1024U*1024U*1024U)
-    {
-      currentThread->loader_->loadOnePageSafeButSlow(address); //load stuff
-    }
-    else
+    // there is no fault status here, a fault on a mapped page can only be a write to a read-only page
+    bool present = currentThread->loader_->arch_memory_.checkAddressValid(address);
+    if (!(address > 8U*1024U*1024U && address < 2U*1024U*1024U*1024U) ||
+        !currentThread->loader_->handlePageFault(address, present, present))
     {
       debug(PM, "[PageFaultHandler] Memory Access Violation: address: %x, loader_: %x\n", address, currentThread->loader_);
       Syscall::exit(9999);
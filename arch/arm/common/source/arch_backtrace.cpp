@@ -1,5 +1,6 @@
 #include "kprintf.h"
 #include "Thread.h"
+#include "KernelStackManager.h"
 #include "arch_backtrace.h"
 #include "InterruptUtils.h"
 #include "ArchThreads.h"
@@ -36,7 +37,7 @@ int backtrace(pointer *call_stack, int size, Thread *thread, bool use_stored_reg
 
     int i = 0;
 
-  void *StackStart = (void*)((uint32)thread->stack_ + sizeof(thread->stack_)); // the stack "starts" at the high addresses...
+  void *StackStart = (void*)((uint32)thread->stack_ + KERNEL_STACK_SIZE); // the stack "starts" at the high addresses...
   void *StackEnd = (void*)thread->stack_; // ... and "ends" at the lower ones.
 
   if (use_stored_registers)
@@ -20,6 +20,14 @@ class BDDriver
 
     virtual uint32 addRequest(BDRequest *) = 0;
 
+    /**
+     * gives up a request which did not complete in time, drivers which finish
+     * requests in addRequest have nothing to do
+     */
+    virtual void cancelRequest(BDRequest *)
+    {
+    }
+
     virtual int32 readSector(uint32, uint32, void *) = 0;
 
     virtual int32 writeSector(uint32, uint32, void *) = 0;
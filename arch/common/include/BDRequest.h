@@ -6,15 +6,11 @@
  *
  * Create the BDRequest object with the proper parameters,
  * pass the instance of that object to the pleaseProcessRequest
- * method of the BDManager and go to sleep.
- * The calling thread will be awaken when the command is
- * processed. No timeouts are implemented so if there is some
- * communication error between the BDManager and the drivers,
- * the thread will be sleeping for a looooong looong time.
- * Possible solution is to implement timeout in sleep in
- * scheduler.
- * The second option is to make a busy wait and check the
- * getStatus() method.
+ * method of the BDManager and wait for its completion
+ * (getCompletion()->wait(BD_REQUEST_TIMEOUT)).
+ * The completion is signalled as soon as the status of the
+ * request changes to BD_DONE or BD_ERROR, usually by the
+ * interrupt handler of the driver.
  * Look at the BD_CMD enum for the list of possible commands.
  *
  */
@@ -23,6 +19,12 @@
 #define _BD_REQUEST_H_
 
 #include "types.h"
+#include "Completion.h"
+
+/**
+ * timer ticks to wait for a request before giving up, about 10 seconds
+ */
+#define BD_REQUEST_TIMEOUT 182
 
 class Thread;
 
@@ -147,6 +149,12 @@ class BDRequest
      */
     Thread *getThread(){ return requesting_thread_; };
 
+    /**
+     * returns the completion which is signalled when the request is done or failed
+     *
+     */
+    Completion *getCompletion(){ return &completion_; };
+
     /**
      * returns the next request
      *
@@ -166,10 +174,15 @@ class BDRequest
     void setResult( uint32 result ){ result_=result; };
 
     /**
-     * sets the status of this request
+     * sets the status of this request, BD_DONE and BD_ERROR signal the completion
      *
      */
-    void setStatus( BD_RESULT status ){ status_=status; };
+    void setStatus( BD_RESULT status )
+    {
+      status_=status;
+      if( status != BD_QUEUED )
+        completion_.complete();
+    };
 
     /**
      * sets the the number of the blocks already read/written \sa getBlocksDone
@@ -218,6 +231,8 @@ class BDRequest
     Thread *requesting_thread_;
     /// next_request in the linked list
     BDRequest *next_request_;
+    /// signalled when the request is done or failed
+    Completion completion_;
 };
 
 #endif
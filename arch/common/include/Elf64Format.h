@@ -65,6 +65,20 @@ class Elf
     static const uint32 ELFDATA2LSB = 1;
     static const uint32 ELFDATA2MSB = 2;
 
+// Program header types
+
+    static const uint32 PT_NULL = 0;
+    static const uint32 PT_LOAD = 1;
+    static const uint32 PT_DYNAMIC = 2;
+    static const uint32 PT_INTERP = 3;
+    static const uint32 PT_NOTE = 4;
+
+// Program header flags
+
+    static const uint32 PF_X = 1;
+    static const uint32 PF_W = 2;
+    static const uint32 PF_R = 4;
+
     typedef uint64 Elf64_Addr;
     typedef uint16 Elf64_Half;
     typedef uint64 Elf64_Off;
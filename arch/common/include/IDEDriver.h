@@ -46,6 +46,15 @@ class IDEDriver
 
     uint32 doDeviceDetection();
 
+    /**
+     * looks for a PCI IDE controller capable of bus master DMA and enables
+     * bus mastering on it
+     * @param bus_master_ports set to the bus master registers of the primary and
+     * the secondary channel, 0 for a channel in native mode
+     * @return true if a controller was found
+     */
+    bool findBusMaster(uint16 bus_master_ports[2]);
+
 };
 
 #endif
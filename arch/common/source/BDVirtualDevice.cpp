@@ -44,32 +44,41 @@ void BDVirtualDevice::addRequest(BDRequest * command)
 }
 ;
 
+/**
+ * drivers access the buffer of a request from their interrupt handler, when the
+ * address space of any process may be active, so buffers in user space are
+ * replaced by kernel memory
+ */
+static bool isUserBuffer(const char *buffer)
+{
+  return (pointer) buffer < 2U * 1024U * 1024U * 1024U;
+}
+
 int32 BDVirtualDevice::readData(uint32 offset, uint32 size, char *buffer)
 {
   assert(buffer);
   assert(offset % block_size_ == 0 && "we can only read multiples of block_size_ from the device");
   assert(size % block_size_ == 0 && "we can only read multiples of block_size_ from the device");
   debug(BD_VIRT_DEVICE, "readData\n");
-  uint32 blocks2read = size / block_size_, jiffies = 0;
+  uint32 blocks2read = size / block_size_;
   uint32 blockoffset = offset / block_size_;
 
   debug(BD_VIRT_DEVICE, "blocks2read %d\n", blocks2read);
-  BDRequest bd(dev_number_, BDRequest::BD_READ, blockoffset, blocks2read, buffer);
+  char *kernel_buffer = isUserBuffer(buffer) ? new char[size] : buffer;
+  BDRequest bd(dev_number_, BDRequest::BD_READ, blockoffset, blocks2read, kernel_buffer);
   addRequest(&bd);
 
-  if (driver_->irq != 0)
-  {
-    bool interrupt_context = ArchInterrupts::disableInterrupts();
-    ArchInterrupts::enableInterrupts();
+  if (driver_->irq != 0 && !bd.getCompletion()->wait(BD_REQUEST_TIMEOUT))
+    driver_->cancelRequest(&bd);
 
-    while (bd.getStatus() == BDRequest::BD_QUEUED && jiffies++ < IO_TIMEOUT)
-      ArchInterrupts::yieldIfIFSet();
-
-    if (!interrupt_context)
-      ArchInterrupts::disableInterrupts();
+  bool done = bd.getStatus() == BDRequest::BD_DONE;
+  if (kernel_buffer != buffer)
+  {
+    if (done)
+      memcpy(buffer, kernel_buffer, size);
+    delete[] kernel_buffer;
   }
-
-  if (bd.getStatus() != BDRequest::BD_DONE)
+  if (!done)
   {
     return -1;
   }
@@ -82,24 +91,23 @@ int32 BDVirtualDevice::writeData(uint32 offset, uint32 size, char *buffer)
   assert(offset % block_size_ == 0 && "we can only write multiples of block_size_ to the device");
   assert(size % block_size_ == 0 && "we can only write multiples of block_size_ to the device");
   debug(BD_VIRT_DEVICE, "writeData\n");
-  uint32 blocks2write = size / block_size_, jiffies = 0;
+  uint32 blocks2write = size / block_size_;
   uint32 blockoffset = offset / block_size_;
 
-  BDRequest bd(dev_number_, BDRequest::BD_WRITE, blockoffset, blocks2write, buffer);
-  addRequest(&bd);
-
-  if (driver_->irq != 0)
+  char *kernel_buffer = buffer;
+  if (isUserBuffer(buffer))
   {
-    bool interrupt_context = ArchInterrupts::disableInterrupts();
-    ArchInterrupts::enableInterrupts();
-
-    while (bd.getStatus() == BDRequest::BD_QUEUED && jiffies++ < IO_TIMEOUT)
-      ArchInterrupts::yieldIfIFSet();
-
-    if (!interrupt_context)
-      ArchInterrupts::disableInterrupts();
+    kernel_buffer = new char[size];
+    memcpy(kernel_buffer, buffer, size);
   }
+  BDRequest bd(dev_number_, BDRequest::BD_WRITE, blockoffset, blocks2write, kernel_buffer);
+  addRequest(&bd);
+
+  if (driver_->irq != 0 && !bd.getCompletion()->wait(BD_REQUEST_TIMEOUT))
+    driver_->cancelRequest(&bd);
 
+  if (kernel_buffer != buffer)
+    delete[] kernel_buffer;
   if (bd.getStatus() != BDRequest::BD_DONE)
     return -1;
   else
@@ -103,7 +103,8 @@ public:
 
 /**
  *
- * on x86: invokes int65, whose handler facilitates a task switch
+ * voluntary task switch of a kernel thread, only the callee-saved registers are
+ * saved instead of a full interrupt frame (int65 is still available for that)
  *
  */
   static void yield();
@@ -86,7 +86,7 @@ pointer ArchCommon::getFreeKernelMemoryStart()
 
 pointer ArchCommon::getFreeKernelMemoryEnd()
 {
-   return (pointer)(1024U*1024U*1024U*2U + 1024U*1024U*4U); //2GB+4MB Ende des Kernel Bereichs fuer den es derzeit Paging gibt
+   return (pointer)(ArchMemory::KERNEL_STACKS_END * PAGE_SIZE); // end of the kernel area covered by the kernel page tables, including the kernel stacks
 }
 
 
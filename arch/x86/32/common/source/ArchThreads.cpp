@@ -4,6 +4,7 @@
 #include "paging-definitions.h"
 #include "offsets.h"
 #include "Thread.h"
+#include "ThreadCache.h"
 #include "kstring.h"
 
 
@@ -22,7 +23,7 @@ void ArchThreads::setAddressSpace(Thread *thread, ArchMemory& arch_memory)
 
 void ArchThreads::createThreadInfosKernelThread(ArchThreadInfo *&info, pointer start_function, pointer stack)
 {
-  info = (ArchThreadInfo*)new uint8[sizeof(ArchThreadInfo)];
+  info = ThreadCache::instance()->allocThreadInfo();
   memset((void*)info, 0, sizeof(ArchThreadInfo));
   pointer root_of_kernel_paging_structure = VIRTUAL_TO_PHYSICAL_BOOT(((pointer)ArchMemory::getRootOfKernelPagingStructure()));
 
@@ -65,9 +66,11 @@ void ArchThreads::changeInstructionPointer(ArchThreadInfo *info, pointer functio
   info->eip = function;
 }
 
+extern "C" void arch_yield();
+
 void ArchThreads::yield()
 {
-  asm("int $65");
+  arch_yield();
 }
 
 uint32 ArchThreads::testSetLock(uint32 &lock, uint32 new_value)
@@ -75,7 +75,7 @@ typedef struct
   uint32 global_page               :1;
   uint32 ignored_3                 :1;
   uint32 ignored_2                 :1;
-  uint32 ignored_1                 :1;
+  uint32 swapped                   :1; // page_ppn holds a swap slot
   uint32 page_ppn                  :20;
 } __attribute__((__packed__)) PageTableEntry;
 
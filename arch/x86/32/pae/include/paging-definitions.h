@@ -94,7 +94,7 @@ typedef struct
   uint64 global_page               :1;
   uint64 ignored_3                 :1;
   uint64 ignored_2                 :1;
-  uint64 ignored_1                 :1;
+  uint64 swapped                   :1; // page_ppn holds a swap slot
   uint64 page_ppn                  :24; // MAXPHYADDR (36) - 12
   uint64 reserved_2                :27; // must be 0
   uint64 execution_disabled        :1;
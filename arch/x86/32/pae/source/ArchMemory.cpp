@@ -29,7 +29,7 @@ void ArchMemory::checkAndRemovePT(uint32 physical_page_directory_page, uint32 pd
   if (!page_directory[pde_vpn].pt.present) return; // PT not present -> do nothing.
 
   for (uint32 pte_vpn=0; pte_vpn < PAGE_TABLE_ENTRIES; ++pte_vpn)
-    if (pte_base[pte_vpn].present > 0)
+    if (pte_base[pte_vpn].present > 0 || pte_base[pte_vpn].swapped)
       return; //not empty -> do nothing
 
   //else:
@@ -56,6 +56,7 @@ void ArchMemory::unmapPage(uint32 virtual_page)
       if (pte_base[pte_vpn].present)
       {
         pte_base[pte_vpn].present = 0;
+        flushTLBEntry(virtual_page);
         PageManager::instance()->freePPN(pte_base[pte_vpn].page_ppn);
       }
       checkAndRemovePT(page_dir_pointer_table_[pdpte_vpn].page_directory_ppn, pde_vpn);
@@ -63,6 +64,195 @@ void ArchMemory::unmapPage(uint32 virtual_page)
   }
 }
 
+PageTableEntry* ArchMemory::getPTE(uint32 virtual_page)
+{
+  RESOLVEMAPPING(page_dir_pointer_table_, virtual_page);
+  if (!page_dir_pointer_table_[pdpte_vpn].present || !page_directory[pde_vpn].pt.present ||
+      page_directory[pde_vpn].page.size)
+    return 0;
+  PageTableEntry *pte_base = (PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.page_table_ppn);
+  return pte_base + pte_vpn;
+}
+
+void ArchMemory::flushTLBEntry(uint32 virtual_page)
+{
+  asm volatile("invlpg (%0)" : : "r"(virtual_page * PAGE_SIZE) : "memory");
+}
+
+uint32 ArchMemory::getMappedPPN(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  if (!pte || !pte->present)
+    return 0;
+  return pte->page_ppn;
+}
+
+void ArchMemory::setPageWriteable(uint32 virtual_page, uint32 writeable)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->present);
+  pte->writeable = writeable;
+  flushTLBEntry(virtual_page);
+}
+
+uint32 ArchMemory::isPageWriteable(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->present);
+  return pte->writeable;
+}
+
+bool ArchMemory::testAndClearDirty(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  if (!pte || !pte->present || !pte->dirty)
+    return false;
+  pte->dirty = 0;
+  flushTLBEntry(virtual_page);
+  return true;
+}
+
+bool ArchMemory::testAndClearAccessed(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  if (!pte || !pte->present || !pte->accessed)
+    return false;
+  pte->accessed = 0;
+  flushTLBEntry(virtual_page);
+  return true;
+}
+
+void ArchMemory::setPageSwapped(uint32 virtual_page, uint32 swap_slot)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && pte->present && swap_slot);
+  pte->present = 0;
+  pte->swapped = 1;
+  pte->page_ppn = swap_slot;
+  flushTLBEntry(virtual_page);
+}
+
+uint32 ArchMemory::getSwapSlot(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  if (!pte || pte->present || !pte->swapped)
+    return 0;
+  return pte->page_ppn;
+}
+
+void ArchMemory::clearSwapSlot(uint32 virtual_page)
+{
+  PageTableEntry *pte = getPTE(virtual_page);
+  assert(pte && !pte->present && pte->swapped);
+  pte->swapped = 0;
+  pte->page_ppn = 0;
+  uint32 pdpte_vpn = virtual_page / (PAGE_TABLE_ENTRIES * PAGE_DIRECTORY_ENTRIES);
+  uint32 pde_vpn = (virtual_page % (PAGE_TABLE_ENTRIES * PAGE_DIRECTORY_ENTRIES)) / PAGE_TABLE_ENTRIES;
+  checkAndRemovePT(page_dir_pointer_table_[pdpte_vpn].page_directory_ppn, pde_vpn);
+}
+
+size_t ArchMemory::mapRange(uint32 virtual_page, size_t num_pages, const size_t* physical_pages, uint32 user_access)
+{
+  size_t mapped = 0;
+  while (mapped < num_pages)
+  {
+    RESOLVEMAPPING(page_dir_pointer_table_, virtual_page + mapped);
+    if (page_dir_pointer_table_[pdpte_vpn].present == 0)
+    {
+      uint32 ppn = PageManager::instance()->allocPPN();
+      page_directory = (PageDirEntry*) getIdentAddressOfPPN(ppn);
+      insertPD(pdpte_vpn, ppn);
+    }
+    if (page_directory[pde_vpn].pt.present == 0)
+      insertPT(page_directory, pde_vpn, PageManager::instance()->allocPPN());
+    assert(!page_directory[pde_vpn].page.size); // only 4 KiB pages allowed
+
+    PageTableEntry *pte_base = (PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.page_table_ppn);
+    for (; pte_vpn < PAGE_TABLE_ENTRIES && mapped < num_pages; ++pte_vpn, ++mapped)
+    {
+      if (pte_base[pte_vpn].present || pte_base[pte_vpn].swapped)
+        return mapped;
+      pte_base[pte_vpn].writeable = 1;
+      pte_base[pte_vpn].accessed = 0;
+      pte_base[pte_vpn].dirty = 0;
+      pte_base[pte_vpn].user_access = user_access;
+      pte_base[pte_vpn].page_ppn = physical_pages[mapped];
+      pte_base[pte_vpn].present = 1;
+    }
+  }
+  return mapped;
+}
+
+size_t ArchMemory::unmapRange(uint32 virtual_page, size_t num_pages)
+{
+  size_t num_unmapped = 0;
+  size_t done = 0;
+  while (done < num_pages)
+  {
+    RESOLVEMAPPING(page_dir_pointer_table_, virtual_page + done);
+    size_t count = Min(num_pages - done, PAGE_TABLE_ENTRIES - pte_vpn);
+    done += count;
+    if (!page_dir_pointer_table_[pdpte_vpn].present || !page_directory[pde_vpn].pt.present)
+      continue;
+    assert(!page_directory[pde_vpn].page.size); // only 4 KiB pages allowed
+
+    PageTableEntry *pte_base = (PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.page_table_ppn);
+    for (; count > 0; --count, ++pte_vpn)
+    {
+      if (!pte_base[pte_vpn].present)
+        continue;
+      // nobody runs in this address space before the flush below, cr3 is reloaded on every switch
+      pte_base[pte_vpn].present = 0;
+      PageManager::instance()->freePPN(pte_base[pte_vpn].page_ppn);
+      ++num_unmapped;
+    }
+    checkAndRemovePT(page_dir_pointer_table_[pdpte_vpn].page_directory_ppn, pde_vpn);
+  }
+  if (num_unmapped)
+    flushTLBRange(virtual_page, num_pages);
+  return num_unmapped;
+}
+
+size_t ArchMemory::protectRange(uint32 virtual_page, size_t num_pages, uint32 writeable)
+{
+  size_t num_changed = 0;
+  size_t done = 0;
+  while (done < num_pages)
+  {
+    RESOLVEMAPPING(page_dir_pointer_table_, virtual_page + done);
+    size_t count = Min(num_pages - done, PAGE_TABLE_ENTRIES - pte_vpn);
+    done += count;
+    if (!page_dir_pointer_table_[pdpte_vpn].present || !page_directory[pde_vpn].pt.present ||
+        page_directory[pde_vpn].page.size)
+      continue;
+
+    PageTableEntry *pte_base = (PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.page_table_ppn);
+    for (; count > 0; --count, ++pte_vpn)
+    {
+      if (pte_base[pte_vpn].present && pte_base[pte_vpn].writeable != writeable)
+      {
+        pte_base[pte_vpn].writeable = writeable;
+        ++num_changed;
+      }
+    }
+  }
+  if (num_changed)
+    flushTLBRange(virtual_page, num_pages);
+  return num_changed;
+}
+
+void ArchMemory::flushTLBRange(uint32 virtual_page, size_t num_pages)
+{
+  if (num_pages > TLB_FLUSH_MAX_PAGES)
+  {
+    // reloading cr3 drops all non global entries at once
+    asm volatile("movl %%cr3, %%eax; movl %%eax, %%cr3;" : : : "eax", "memory");
+    return;
+  }
+  for (size_t i = 0; i < num_pages; ++i)
+    flushTLBEntry(virtual_page + i);
+}
+
 void ArchMemory::insertPD(uint32 pdpt_vpn, uint32 physical_page_directory_page)
 {
   kprintfd("insertPD: pdpt %x pdpt_vpn %x physical_page_table_page %x\n",page_dir_pointer_table_,pdpt_vpn,physical_page_directory_page);
@@ -103,6 +293,9 @@ void ArchMemory::mapPage(uint32 virtual_page,
 
     PageTableEntry *pte_base = (PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.page_table_ppn);
     pte_base[pte_vpn].writeable = 1;
+    pte_base[pte_vpn].accessed = 0;
+    pte_base[pte_vpn].dirty = 0;
+    pte_base[pte_vpn].swapped = 0;
     pte_base[pte_vpn].user_access = user_access;
     pte_base[pte_vpn].page_ppn = physical_page;
     pte_base[pte_vpn].present = 1;
@@ -227,6 +420,26 @@ void ArchMemory::mapKernelPage(uint32 virtual_page, uint32 physical_page)
   pte_base[pte_vpn].present = 1;
 }
 
+void ArchMemory::mapKernelRange(uint32 virtual_page, size_t num_pages, const size_t* physical_pages)
+{
+  PageDirPointerTableEntry *pdpt = kernel_page_directory_pointer_table;
+  size_t mapped = 0;
+  while (mapped < num_pages)
+  {
+    RESOLVEMAPPING(pdpt, virtual_page + mapped);
+    assert(pdpt[pdpte_vpn].present);
+    assert(page_directory[pde_vpn].pt.present && page_directory[pde_vpn].pt.size == 0);
+    PageTableEntry *pte_base = (PageTableEntry *) getIdentAddressOfPPN(page_directory[pde_vpn].pt.page_table_ppn);
+    for (; pte_vpn < PAGE_TABLE_ENTRIES && mapped < num_pages; ++pte_vpn, ++mapped)
+    {
+      assert(!pte_base[pte_vpn].present);
+      pte_base[pte_vpn].writeable = 1;
+      pte_base[pte_vpn].page_ppn = physical_pages[mapped];
+      pte_base[pte_vpn].present = 1;
+    }
+  }
+}
+
 void ArchMemory::unmapKernelPage(uint32 virtual_page)
 {
   PageDirPointerTableEntry *pdpt = kernel_page_directory_pointer_table;
@@ -237,6 +450,7 @@ void ArchMemory::unmapKernelPage(uint32 virtual_page)
   assert(pte_base[pte_vpn].present);
   pte_base[pte_vpn].present = 0;
   pte_base[pte_vpn].writeable = 0;
+  flushTLBEntry(virtual_page);
   PageManager::instance()->freePPN(pte_base[pte_vpn].page_ppn);
 }
 
@@ -11,6 +11,11 @@
 #include "offsets.h"
 #include "paging-definitions.h"
 
+/**
+ * ranges of more pages reload cr3 instead of invalidating single TLB entries
+ */
+#define TLB_FLUSH_MAX_PAGES 32
+
 class ArchMemoryMapping
 {
   public:
@@ -70,6 +75,103 @@ public:
  * @param virtual_page which will be invalidated
  */
   bool unmapPage(uint64 virtual_page);
+
+/**
+ * returns the physical page a virtual page of this address space is mapped to
+ *
+ * @param virtual_page the virtual page to look up
+ * @return the physical page number, 0 if the virtual page is not mapped
+ */
+  uint64 getMappedPPN(uint64 virtual_page);
+
+/**
+ * changes the writeable flag of an existing 4 KiB mapping
+ *
+ * @param virtual_page the mapped virtual page
+ * @param writeable 1 to allow writes, 0 for a read-only mapping
+ */
+  void setPageWriteable(uint64 virtual_page, uint64 writeable);
+
+/**
+ * @param virtual_page the mapped virtual page
+ * @return the writeable flag of an existing 4 KiB mapping
+ */
+  uint64 isPageWriteable(uint64 virtual_page);
+
+/**
+ * checks whether a mapped page has been written to and resets its dirty flag
+ *
+ * @param virtual_page the mapped virtual page
+ * @return true if the page was written to since the last call
+ */
+  bool testAndClearDirty(uint64 virtual_page);
+
+/**
+ * checks whether a mapped page has been accessed and resets its accessed flag
+ *
+ * @param virtual_page the mapped virtual page
+ * @return true if the page was accessed since the last call
+ */
+  bool testAndClearAccessed(uint64 virtual_page);
+
+/**
+ * replaces the mapping of a virtual page by a reference to a swap slot, the
+ * physical page is not freed
+ *
+ * @param virtual_page the mapped virtual page
+ * @param swap_slot the swap slot holding the content of the page, must not be 0
+ */
+  void setPageSwapped(uint64 virtual_page, uint64 swap_slot);
+
+/**
+ * returns the swap slot of a swapped out virtual page
+ *
+ * @param virtual_page the virtual page
+ * @return the swap slot, 0 if the page is not swapped out
+ */
+  uint64 getSwapSlot(uint64 virtual_page);
+
+/**
+ * removes the reference to a swap slot from a swapped out virtual page
+ *
+ * @param virtual_page the swapped out virtual page
+ */
+  void clearSwapSlot(uint64 virtual_page);
+
+/**
+ * maps a range of virtual pages, the page tables are looked up (and allocated
+ * if missing) once per page table instead of once per page
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages to map
+ * @param physical_pages the physical pages, one per virtual page
+ * @param user_access PTE User/Supervisor Flag
+ * @return the number of pages mapped, mapping stops at the first page which is
+ * mapped or swapped out already, the physical pages behind it are left to the caller
+ */
+  size_t mapRange(uint64 virtual_page, size_t num_pages, const size_t* physical_pages, uint64 user_access);
+
+/**
+ * unmaps and frees all mapped pages of a range and removes empty page tables,
+ * swapped out pages are left alone. The TLB is flushed once for the whole range.
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages
+ * @return the number of pages unmapped
+ */
+  size_t unmapRange(uint64 virtual_page, size_t num_pages);
+
+/**
+ * changes the writeable flag of all mapped pages of a range, the TLB is flushed
+ * once for the whole range
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages
+ * @param writeable 1 to allow writes, 0 for read-only mappings
+ * @return the number of pages changed
+ */
+  size_t protectRange(uint64 virtual_page, size_t num_pages, uint64 writeable);
+
 /**
  * Destructor. Recursively deletes the pml4
  *
@@ -127,6 +229,15 @@ public:
  */
   static void mapKernelPage(uint64 virtual_page, uint64 physical_page);
 
+/**
+ * maps a range of virtual pages in kernel mapping, the page tables have to exist
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages to map
+ * @param physical_pages the physical pages, one per virtual page
+ */
+  static void mapKernelRange(uint64 virtual_page, size_t num_pages, const size_t* physical_pages);
+
 /**
  * removes the mapping to a virtual_page by marking its PTE Entry as non valid
  * in kernel mapping
@@ -143,6 +254,13 @@ public:
   static const size_t RESERVED_START = 0xFFFFFFFF80000ULL;
   static const size_t RESERVED_END = 0xFFFFFFFFC0000ULL;
 
+/**
+ * virtual pages of the kernel stacks, the last 4 MiB covered by the kernel page tables
+ * (the kernel heap ends where they start)
+ */
+  static const size_t KERNEL_STACKS_START = 0xFFFFFFFF80C00ULL;
+  static const size_t KERNEL_STACKS_END = 0xFFFFFFFF81000ULL;
+
 private:
 
 /** 
@@ -166,6 +284,22 @@ private:
  */
   template<typename T> static bool checkAndRemove(pointer map_ptr, uint64 index);
 
+/**
+ * invalidates the TLB entry of a virtual page
+ *
+ * @param virtual_page the virtual page
+ */
+  static void flushTLBEntry(uint64 virtual_page);
+
+/**
+ * invalidates the TLB entries of a range of virtual pages, large ranges flush
+ * the whole TLB
+ *
+ * @param virtual_page the first virtual page
+ * @param num_pages the number of pages
+ */
+  static void flushTLBRange(uint64 virtual_page, size_t num_pages);
+
 };
 
 #endif
@@ -134,7 +134,8 @@ typedef struct
   uint64 dirty                     :1;
   uint64 size                      :1;
   uint64 global                    :1;
-  uint64 ignored_2                 :3;
+  uint64 swapped                   :1; // page_ppn holds a swap slot
+  uint64 ignored_2                 :2;
   uint64 page_ppn                  :28;
   uint64 reserved_1                :12; // must be 0
   uint64 ignored_1                 :11;
@@ -32,7 +32,8 @@ bool ArchMemory::checkAndRemove(pointer map_ptr, uint64 index)
   ((uint64*) map)[index] = 0;
   for (uint64 i = 0; i < PAGE_DIR_ENTRIES; i++)
   {
-    if (map[index].present != 0)
+    // checks the raw entries, swapped out pages are not present but still in use
+    if (((uint64*) map)[i] != 0)
       return false;
   }
   return true;
@@ -43,6 +44,7 @@ bool ArchMemory::unmapPage(uint64 virtual_page)
   ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
 
   assert(m.page_ppn != 0 && m.page_size == PAGE_SIZE);
+  uint64 page_ppn = m.page_ppn;
   bool empty = checkAndRemove<PageTableEntry>(getIdentAddressOfPPN(m.pt_ppn), m.pti);
   if (empty)
     empty = checkAndRemove<PageDirPageEntry>(getIdentAddressOfPPN(m.pd_ppn), m.pdi);
@@ -50,9 +52,195 @@ bool ArchMemory::unmapPage(uint64 virtual_page)
     empty = checkAndRemove<PageDirPointerTablePageDirEntry>(getIdentAddressOfPPN(m.pdpt_ppn), m.pdpti);
   if (empty)
     empty = checkAndRemove<PageMapLevel4Entry>(getIdentAddressOfPPN(m.pml4_ppn), m.pml4i);
+  flushTLBEntry(virtual_page);
+  PageManager::instance()->freePPN(page_ppn);
   return true;
 }
 
+void ArchMemory::flushTLBEntry(uint64 virtual_page)
+{
+  asm volatile("invlpg (%0)" : : "r"(virtual_page * PAGE_SIZE) : "memory");
+}
+
+uint64 ArchMemory::getMappedPPN(uint64 virtual_page)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  if (m.page_size != PAGE_SIZE)
+    return 0;
+  return m.page_ppn;
+}
+
+void ArchMemory::setPageWriteable(uint64 virtual_page, uint64 writeable)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  assert(m.pt && m.page_size == PAGE_SIZE);
+  m.pt[m.pti].writeable = writeable;
+  flushTLBEntry(virtual_page);
+}
+
+uint64 ArchMemory::isPageWriteable(uint64 virtual_page)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  assert(m.pt && m.page_size == PAGE_SIZE);
+  return m.pt[m.pti].writeable;
+}
+
+bool ArchMemory::testAndClearDirty(uint64 virtual_page)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  if (!m.pt || m.page_size != PAGE_SIZE || !m.pt[m.pti].dirty)
+    return false;
+  m.pt[m.pti].dirty = 0;
+  flushTLBEntry(virtual_page);
+  return true;
+}
+
+bool ArchMemory::testAndClearAccessed(uint64 virtual_page)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  if (!m.pt || m.page_size != PAGE_SIZE || !m.pt[m.pti].accessed)
+    return false;
+  m.pt[m.pti].accessed = 0;
+  flushTLBEntry(virtual_page);
+  return true;
+}
+
+void ArchMemory::setPageSwapped(uint64 virtual_page, uint64 swap_slot)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  assert(m.pt && m.page_size == PAGE_SIZE && swap_slot);
+  m.pt[m.pti].present = 0;
+  m.pt[m.pti].swapped = 1;
+  m.pt[m.pti].page_ppn = swap_slot;
+  flushTLBEntry(virtual_page);
+}
+
+uint64 ArchMemory::getSwapSlot(uint64 virtual_page)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  if (!m.pt || m.pt[m.pti].present || !m.pt[m.pti].swapped)
+    return 0;
+  return m.pt[m.pti].page_ppn;
+}
+
+void ArchMemory::clearSwapSlot(uint64 virtual_page)
+{
+  ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page);
+  assert(m.pt && !m.pt[m.pti].present && m.pt[m.pti].swapped);
+  bool empty = checkAndRemove<PageTableEntry>(getIdentAddressOfPPN(m.pt_ppn), m.pti);
+  if (empty)
+    empty = checkAndRemove<PageDirPageEntry>(getIdentAddressOfPPN(m.pd_ppn), m.pdi);
+  if (empty)
+    empty = checkAndRemove<PageDirPointerTablePageDirEntry>(getIdentAddressOfPPN(m.pdpt_ppn), m.pdpti);
+  if (empty)
+    empty = checkAndRemove<PageMapLevel4Entry>(getIdentAddressOfPPN(m.pml4_ppn), m.pml4i);
+}
+
+size_t ArchMemory::mapRange(uint64 virtual_page, size_t num_pages, const size_t* physical_pages, uint64 user_access)
+{
+  size_t mapped = 0;
+  while (mapped < num_pages)
+  {
+    ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page + mapped);
+    uint64 pti = m.pti;
+    if (!m.pt)
+    {
+      if (m.page)
+        return mapped; // part of a large page
+      // the first page of the table sets up the missing levels
+      mapPage(virtual_page + mapped, physical_pages[mapped], user_access);
+      m = resolveMapping(page_map_level_4_, virtual_page + mapped);
+      ++mapped;
+      ++pti;
+    }
+    for (; pti < PAGE_TABLE_ENTRIES && mapped < num_pages; ++pti, ++mapped)
+    {
+      // swapped out pages are not present but have a non zero entry
+      if (((uint64*) m.pt)[pti] != 0)
+        return mapped;
+      insert<PageTableEntry>((pointer) m.pt, pti, physical_pages[mapped], 0, 0, user_access, 1);
+    }
+  }
+  return mapped;
+}
+
+size_t ArchMemory::unmapRange(uint64 virtual_page, size_t num_pages)
+{
+  size_t num_unmapped = 0;
+  size_t done = 0;
+  while (done < num_pages)
+  {
+    ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page + done);
+    size_t count = Min(num_pages - done, PAGE_TABLE_ENTRIES - m.pti);
+    done += count;
+    if (!m.pt)
+      continue;
+
+    uint64 cleared = PAGE_TABLE_ENTRIES;
+    for (uint64 pti = m.pti; count > 0; --count, ++pti)
+    {
+      if (!m.pt[pti].present)
+        continue;
+      // nobody runs in this address space before the flush below, cr3 is reloaded on every switch
+      uint64 page_ppn = m.pt[pti].page_ppn;
+      ((uint64*) m.pt)[pti] = 0;
+      PageManager::instance()->freePPN(page_ppn);
+      cleared = pti;
+      ++num_unmapped;
+    }
+    if (cleared == PAGE_TABLE_ENTRIES)
+      continue;
+    bool empty = checkAndRemove<PageTableEntry>(getIdentAddressOfPPN(m.pt_ppn), cleared);
+    if (empty)
+      empty = checkAndRemove<PageDirPageEntry>(getIdentAddressOfPPN(m.pd_ppn), m.pdi);
+    if (empty)
+      empty = checkAndRemove<PageDirPointerTablePageDirEntry>(getIdentAddressOfPPN(m.pdpt_ppn), m.pdpti);
+    if (empty)
+      empty = checkAndRemove<PageMapLevel4Entry>(getIdentAddressOfPPN(m.pml4_ppn), m.pml4i);
+  }
+  if (num_unmapped)
+    flushTLBRange(virtual_page, num_pages);
+  return num_unmapped;
+}
+
+size_t ArchMemory::protectRange(uint64 virtual_page, size_t num_pages, uint64 writeable)
+{
+  size_t num_changed = 0;
+  size_t done = 0;
+  while (done < num_pages)
+  {
+    ArchMemoryMapping m = resolveMapping(page_map_level_4_, virtual_page + done);
+    size_t count = Min(num_pages - done, PAGE_TABLE_ENTRIES - m.pti);
+    done += count;
+    if (!m.pt)
+      continue;
+
+    for (uint64 pti = m.pti; count > 0; --count, ++pti)
+    {
+      if (m.pt[pti].present && m.pt[pti].writeable != writeable)
+      {
+        m.pt[pti].writeable = writeable;
+        ++num_changed;
+      }
+    }
+  }
+  if (num_changed)
+    flushTLBRange(virtual_page, num_pages);
+  return num_changed;
+}
+
+void ArchMemory::flushTLBRange(uint64 virtual_page, size_t num_pages)
+{
+  if (num_pages > TLB_FLUSH_MAX_PAGES)
+  {
+    // reloading cr3 drops all non global entries at once
+    asm volatile("movq %%cr3, %%rax; movq %%rax, %%cr3;" : : : "rax", "memory");
+    return;
+  }
+  for (size_t i = 0; i < num_pages; ++i)
+    flushTLBEntry(virtual_page + i);
+}
+
 template<typename T>
 bool ArchMemory::insert(pointer map_ptr, uint64 index, uint64 ppn, uint64 bzero, uint64 size, uint64 user_access,
                         uint64 writeable)
@@ -114,6 +302,7 @@ bool ArchMemory::mapPage(uint64 virtual_page, uint64 physical_page, uint64 user_
 
   if (m.page_ppn == 0 && page_size == PAGE_SIZE)
   {
+    ((uint64*) getIdentAddressOfPPN(m.pt_ppn))[m.pti] = 0; // clears accessed, dirty and swapped
     return insert<PageTableEntry>(getIdentAddressOfPPN(m.pt_ppn), m.pti, physical_page, 0, 0, user_access, 1);
   }
   assert(false); // you should never get here
@@ -294,6 +483,24 @@ void ArchMemory::mapKernelPage(size_t virtual_page, size_t physical_page)
   pt[mapping.pti].page_ppn = physical_page;
 }
 
+void ArchMemory::mapKernelRange(size_t virtual_page, size_t num_pages, const size_t* physical_pages)
+{
+  size_t mapped = 0;
+  while (mapped < num_pages)
+  {
+    ArchMemoryMapping m = resolveMapping(((uint64) VIRTUAL_TO_PHYSICAL_BOOT(kernel_page_map_level_4) / PAGE_SIZE),
+                                         virtual_page + mapped);
+    assert(m.pt);
+    for (uint64 pti = m.pti; pti < PAGE_TABLE_ENTRIES && mapped < num_pages; ++pti, ++mapped)
+    {
+      assert(!m.pt[pti].present);
+      m.pt[pti].present = 1;
+      m.pt[pti].writeable = 1;
+      m.pt[pti].page_ppn = physical_pages[mapped];
+    }
+  }
+}
+
 void ArchMemory::unmapKernelPage(size_t virtual_page)
 {
   ArchMemoryMapping mapping = resolveMapping(((uint64) VIRTUAL_TO_PHYSICAL_BOOT(kernel_page_map_level_4) / PAGE_SIZE),
@@ -308,6 +515,7 @@ void ArchMemory::unmapKernelPage(size_t virtual_page)
   assert(pt[mapping.pti].present);
   pt[mapping.pti].present = 0;
   pt[mapping.pti].writeable = 0;
+  flushTLBEntry(virtual_page);
   PageManager::instance()->freePPN(pt[mapping.pti].page_ppn);
 }
 
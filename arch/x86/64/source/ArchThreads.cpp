@@ -5,6 +5,7 @@
 #include "offsets.h"
 #include "assert.h"
 #include "Thread.h"
+#include "ThreadCache.h"
 #include "kstring.h"
 
 extern PageMapLevel4Entry kernel_page_map_level_4[];
@@ -30,7 +31,7 @@ uint32 ArchThreads::getPageDirPointerTable(Thread *thread)
 
 void ArchThreads::createThreadInfosKernelThread(ArchThreadInfo *&info, pointer start_function, pointer stack)
 {
-  info = (ArchThreadInfo*)new uint8[sizeof(ArchThreadInfo)];
+  info = ThreadCache::instance()->allocThreadInfo();
   memset((void*)info, 0, sizeof(ArchThreadInfo));
   pointer pml4 = (pointer)VIRTUAL_TO_PHYSICAL_BOOT(kernel_page_map_level_4);
 
@@ -63,7 +64,7 @@ void ArchThreads::changeInstructionPointer(ArchThreadInfo *info, pointer functio
 
 void ArchThreads::createThreadInfosUserspaceThread(ArchThreadInfo *&info, pointer start_function, pointer user_stack, pointer kernel_stack)
 {
-  info = (ArchThreadInfo*)new uint8[sizeof(ArchThreadInfo)];
+  info = ThreadCache::instance()->allocThreadInfo();
   memset((void*)info, 0, sizeof(ArchThreadInfo));
   pointer pml4 = (pointer)VIRTUAL_TO_PHYSICAL_BOOT(kernel_page_map_level_4);
 
@@ -93,12 +94,11 @@ void ArchThreads::createThreadInfosUserspaceThread(ArchThreadInfo *&info, pointe
 
 }
 
+extern "C" void arch_yield();
+
 void ArchThreads::yield()
 {
-  __asm__ __volatile__("int $65"
-  :
-  :
-  );
+  arch_yield();
 }
 
 size_t ArchThreads::testSetLock(size_t &lock, size_t new_value)
@@ -199,6 +199,14 @@ extern "C" void irqHandler_65()
   arch_contextSwitch();
 }
 
+extern "C" void arch_yieldSchedule()
+{
+  assert(!currentThread || currentThread->stack_[0] == STACK_CANARY);
+  assert(!currentThread || !currentThread->switch_to_userspace_);
+  Scheduler::instance()->schedule();
+  arch_contextSwitch();
+}
+
 
 extern "C" void arch_pageFaultHandler();
 extern "C" void pageFaultHandler(uint64 address, uint64 error)
@@ -281,11 +289,8 @@ extern "C" void pageFaultHandler(uint64 address, uint64 error)
   ArchInterrupts::enableInterrupts();
 
   //lets hope this Exeption wasn't thrown during a TaskSwitch
-  if (! (error & FLAG_PF_PRESENT) && address < 0xFFFFFFFF00000000ULL && currentThread->loader_)
-  {
-    currentThread->loader_->loadOnePageSafeButSlow(address); //load stuff
-  }
-  else
+  if (address >= 0xFFFFFFFF00000000ULL || !currentThread->loader_ ||
+      !currentThread->loader_->handlePageFault(address, error & FLAG_PF_PRESENT, error & FLAG_PF_RDWR))
   {
     debug(PM, "[PageFaultHandler] !(error & FLAG_PF_PRESENT): %x, address: %x, loader_: %x\n",
         !(error & FLAG_PF_PRESENT), address < 0xFFFFFFFF00000000ULL, currentThread->loader_);
@@ -11,6 +11,18 @@
 
 class BDRequest;
 
+/**
+ * maximum number of sectors of a single ATA command (the sector count register
+ * has 8 bits), adjacent requests are merged up to this size
+ */
+#define ATA_MAX_SECTORS 255
+
+/**
+ * number of pages of the buffer bus master DMA transfers go through, commands
+ * larger than that are transferred with PIO
+ */
+#define ATA_DMA_PAGES 16
+
 class ATADriver : public BDDriver
 {
   public:
@@ -21,12 +33,36 @@ class ATADriver : public BDDriver
     } BD_ATA_MODES;
 
     /**
-     * adds the given request to a list and checkes the type of the
-     * request. If it is a read or write request, it is beeing executed,
-     * or the function returns otherwise.
+     * queues a read or write request and returns, the completion of the request
+     * is signalled by the interrupt handler. Without interrupts the request is
+     * executed at once.
+     *
+     * Queued requests are sorted by their start sector and served in one
+     * direction (C-LOOK elevator): the next request is the first one at or
+     * behind the end of the previous one, or the lowest one when there is none.
+     * Requests of the same type continuing each other are merged into one
+     * command. Overlapping requests must not be queued at the same time, the
+     * block cache never does that. Write requests are completed after the
+     * FLUSH CACHE command following their command.
      *
      */
     uint32 addRequest(BDRequest *);
+
+    /**
+     * removes a request which timed out from the queue and marks it as failed,
+     * the controller is reset if the request is being transferred
+     */
+    void cancelRequest(BDRequest *);
+
+    /**
+     * switches the driver to bus master DMA if the drive supports it,
+     * interrupts work and the DMA buffer lies below 4 GiB, PIO stays in use
+     * otherwise. The bus master of a channel may only be given to one drive.
+     * @param bus_master_port the bus master registers of the channel of the
+     * drive (BAR4 of the PCI IDE controller, +8 for the secondary channel)
+     * @return true if DMA is used from now on
+     */
+    bool enableDMA(uint16 bus_master_port);
     ATADriver(uint16 baseport, uint16 getdrive, uint16 irqnum);
     virtual ~ATADriver()
     {
@@ -41,6 +77,8 @@ class ATADriver : public BDDriver
     int32 rawReadSector(uint32, uint32, void *);
 
     /**
+     * polls the drive until the sectors are read, with interrupts enabled
+     * it only starts the command (see testIRQ)
      * @param 1 sector where it should be started to read
      * @param 2 number of sectors
      * @param 3 buffer where to save all that was read
@@ -49,6 +87,7 @@ class ATADriver : public BDDriver
     int32 readSector(uint32, uint32, void *);
 
     /**
+     * polls the drive until the sectors are written and flushed
      * @param 1 sector where it should be started to write
      * @param 2 number of sectors
      * @param 3 buffer, which content should be written to the sectors
@@ -85,8 +124,98 @@ class ATADriver : public BDDriver
 
   private:
 
+    /**
+     * an entry of the physical region descriptor table the bus master reads
+     * the memory regions of a transfer from
+     */
+    struct PRDEntry
+    {
+      uint32 address;
+      uint16 byte_count; // 0 means 64 KiB
+      uint16 flags; // PRD_END_OF_TABLE marks the last entry
+    } __attribute__((packed));
+
     int32 selectSector(uint32 start_sector, uint32 num_sectors);
 
+    /**
+     * selects the drive and writes the start sector and the number of sectors
+     * of a command to the task file registers
+     */
+    void setRegisters(uint32 start_sector, uint32 num_sectors);
+
+    /**
+     * starts a command without waiting for the drive, to be used from the
+     * interrupt handler; the polling readSector and writeSector are only used
+     * without interrupts
+     * @return -1 if the drive is still busy
+     */
+    int32 issueCommand(uint8 command, uint32 start_sector, uint32 num_sectors);
+
+    /**
+     * starts a PIO write of the active requests and transfers the first sector
+     * @param num_sectors the number of sectors of all active requests
+     */
+    int32 startPIOWrite(uint32 num_sectors);
+
+    /**
+     * transfers the next sector of the active request to the drive
+     */
+    void writeActiveSector();
+
+    /**
+     * inserts a request into the queue sorted by start sector,
+     * interrupts have to be disabled
+     */
+    void queueRequest(BDRequest *br);
+
+    /**
+     * starts the next queued request together with the ones merged into it if
+     * the controller is idle, interrupts have to be disabled
+     */
+    void dispatch();
+
+    /**
+     * marks the active request as done or failed and moves on to the next one
+     * merged into the same command, interrupts have to be disabled
+     * @return true if the command has more requests
+     */
+    bool finishActive(bool success);
+
+    /**
+     * starts a FLUSH CACHE command if the finished command wrote data, the
+     * next queued command otherwise, interrupts have to be disabled
+     */
+    void finishCommand();
+
+    /**
+     * completes the written requests waiting for the FLUSH CACHE command
+     */
+    void completeWritten(bool success);
+
+    /**
+     * marks the requests of the active command as failed and resets the controller
+     */
+    void abortActive();
+
+    /**
+     * starts a READ DMA or WRITE DMA command for the active requests, the data
+     * of a write is copied to the DMA buffer first
+     * @param num_sectors the number of sectors of all active requests
+     */
+    int32 startDMA(uint32 num_sectors);
+
+    /**
+     * copies the data of the active requests to or from the DMA buffer
+     * @param to_buffer true to copy the data to be written to the DMA buffer
+     */
+    void copyDMABuffer(bool to_buffer);
+
+    /**
+     * stops the bus master after the interrupt of a DMA command and completes
+     * the active requests
+     */
+    void finishDMA();
+
     uint32 numsec;
 
     uint16 port;
@@ -96,8 +225,35 @@ class ATADriver : public BDDriver
 
     BD_ATA_MODES mode; // mode see enum BD_ATA_MODES
 
+    /**
+     * the queued requests sorted by start sector, linked via next_request_
+     */
     BDRequest *request_list_;
-    BDRequest *request_list_tail_;
+
+    /**
+     * the request of the running command being transferred, the requests merged
+     * into the command follow it via next_request_
+     */
+    BDRequest *active_;
+
+    /**
+     * the requests of the last write command whose data has been transferred,
+     * they are completed when the FLUSH CACHE command is done
+     */
+    BDRequest *written_;
+    bool flushing_; // a FLUSH CACHE command is running
+
+    /**
+     * the sector behind the last dispatched command
+     */
+    uint32 head_position_;
+
+    bool dma_supported_;
+    bool active_dma_; // the active command is a DMA transfer
+    uint16 bus_master_port_;
+    PRDEntry *prd_table_;
+    uint32 prd_ppn_;
+    uint32 dma_pages_[ATA_DMA_PAGES];
 
     Mutex lock_;
 };
@@ -112,4 +112,27 @@ static inline void outportwp(uint16 port, uint16 value)
   asm volatile ("outb %al,$0x80");
 }
 
+/**
+ * reads 1 double word from the selected I/O port
+ * @param port the I/O port number which is read
+ *
+ */
+static inline uint32 inportl(uint16 port)
+{
+  uint32 _res;
+  asm volatile ("inl %1, %0" : "=a" (_res) : "Nd" (port));
+  return _res;
+}
+
+/**
+ * sends 1 double word of data to the specified I/O port
+ * @param port the I/O port number to send data to
+ * @param value data value sent to I/O port
+ *
+ */
+static inline void outportl(uint16 port, uint32 value)
+{
+  asm volatile ("outl %0, %1" : : "a" (value), "Nd" (port));
+}
+
 #endif
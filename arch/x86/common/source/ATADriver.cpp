@@ -9,6 +9,39 @@
 #include "kprintf.h"
 
 #include "Thread.h"
+#include "PageManager.h"
+#include "ArchMemory.h"
+#include "kstring.h"
+
+/**
+ * registers of the bus master of a channel, relative to its base port
+ */
+#define BM_COMMAND 0
+#define BM_STATUS 2
+#define BM_PRD_TABLE 4
+
+#define BM_START 0x01
+#define BM_READ 0x08 // the bus master writes to memory
+#define BM_ERROR 0x02
+#define BM_INTERRUPT 0x04
+
+#define PRD_END_OF_TABLE 0x8000
+
+#define ATA_READ_SECTORS 0x20
+#define ATA_WRITE_SECTORS 0x30
+#define ATA_READ_DMA 0xC8
+#define ATA_WRITE_DMA 0xCA
+#define ATA_FLUSH_CACHE 0xE7
+
+#define ATA_STATUS_ERROR 0x01
+#define ATA_STATUS_DRQ 0x08
+#define ATA_STATUS_BUSY 0x80
+
+/**
+ * reads of the alternate status register waiting for the drive to take the
+ * first sector of a PIO write (about 1 ms), the only wait with interrupts off
+ */
+#define ATA_DRQ_POLLS 1000
 
 #define TIMEOUT_WARNING() do { kprintfd("%s:%d: timeout. THIS MIGHT CAUSE SERIOUS TROUBLE!\n", __PRETTY_FUNCTION__, __LINE__); } while (0)
 
@@ -20,7 +53,9 @@
                                          BODY;\
                                        }
 
-ATADriver::ATADriver( uint16 baseport, uint16 getdrive, uint16 irqnum ) : lock_("ATADriver::lock_")
+ATADriver::ATADriver( uint16 baseport, uint16 getdrive, uint16 irqnum ) :
+    request_list_(0), active_(0), written_(0), flushing_(false), head_position_(0), dma_supported_(false), active_dma_(false),
+    bus_master_port_(0), prd_table_(0), prd_ppn_(0), lock_("ATADriver::lock_")
 {
   debug(ATA_DRIVER, "ctor: Entered with irgnum %d and baseport %d!!\n", irqnum, baseport);
 
@@ -43,6 +78,9 @@ ATADriver::ATADriver( uint16 baseport, uint16 getdrive, uint16 irqnum ) : lock_(
 
   debug(ATA_DRIVER, "ctor: Disk geometry read !!\n");
 
+  dma_supported_ = (dd[49] & 0x100) != 0;
+  debug(ATA_DRIVER, "ctor: DMA support: %d\n", dma_supported_);
+
   HPC = dd[3];
   SPT = dd[6];
   uint32 CYLS = dd[1];
@@ -63,9 +101,6 @@ ATADriver::ATADriver( uint16 baseport, uint16 getdrive, uint16 irqnum ) : lock_(
   irq = irqnum;
   debug(ATA_DRIVER, "ctor: mode: %d !!\n", mode );
 
-  request_list_ = 0;
-  request_list_tail_ = 0;
-
   debug(ATA_DRIVER, "ctor: Driver created !!\n");
   return;
 }
@@ -102,6 +137,16 @@ int32 ATADriver::selectSector(uint32 start_sector, uint32 num_sectors)
   /* Wait for drive to clear BUSY */
   TIMEOUT_CHECK(inportbp(port + 7) & 0x80,TIMEOUT_WARNING(); return -1;);
 
+  setRegisters(start_sector, num_sectors);
+
+  /* Wait for drive to set DRDY */
+  TIMEOUT_CHECK(!inportbp(port + 7) & 0x40,TIMEOUT_WARNING(); return -1;);
+
+  return 0;
+}
+
+void ATADriver::setRegisters(uint32 start_sector, uint32 num_sectors)
+{
   //LBA: linear base address of the block
   //CYL: value of the cylinder CHS coordinate
   //HPC: number of heads per cylinder for the disk
@@ -126,13 +171,31 @@ int32 ATADriver::selectSector(uint32 start_sector, uint32 num_sectors)
   outportbp(port + 3, sect); // starting sector
   outportbp(port + 4, lo); // cylinder low
   outportbp(port + 5, high); // cylinder high
+}
 
-  /* Wait for drive to set DRDY */
-  TIMEOUT_CHECK(!inportbp(port + 7) & 0x40,TIMEOUT_WARNING(); return -1;);
-
+int32 ATADriver::issueCommand(uint8 command, uint32 start_sector, uint32 num_sectors)
+{
+  setRegisters(start_sector, num_sectors);
+  // the drive needs 400ns after being selected before its status is valid
+  for (uint32 i = 0; i < 4; ++i)
+    inportbp(port + 0x206);
+  // the interrupt of the previous command has been served, a busy drive is stuck
+  if (inportbp(port + 0x206) & (ATA_STATUS_BUSY | ATA_STATUS_DRQ))
+  {
+    debug(ATA_DRIVER, "issueCommand: drive is busy\n");
+    return -1;
+  }
+  outportbp(port + 7, command);
   return 0;
 }
 
+void ATADriver::writeActiveSector()
+{
+  uint16 *word_buff = (uint16 *) active_->getBuffer() + active_->getBlocksDone() * 256;
+  for (uint32 counter = 0; counter != 256; counter++)
+    outportw(port, word_buff[counter]);
+}
+
 int32 ATADriver::readSector ( uint32 start_sector, uint32 num_sectors, void *buffer )
 {
   assert(buffer || (start_sector == 0 && num_sectors == 1));
@@ -142,7 +205,7 @@ int32 ATADriver::readSector ( uint32 start_sector, uint32 num_sectors, void *buf
   for (int i = 0;; ++i)
   {
     /* Write the command code to the command register */
-    outportbp(port + 7, 0x20); // command
+    outportbp(port + 7, ATA_READ_SECTORS); // command
 
     if (mode != BD_PIO_NO_IRQ)
       return 0;
@@ -185,14 +248,12 @@ int32 ATADriver::writeSector ( uint32 start_sector, uint32 num_sectors, void * b
   uint16 *word_buff = (uint16 *) buffer;
 
   /* Write the command code to the command register */
-  outportbp( port + 7, 0x30 );           // command
+  outportbp( port + 7, ATA_WRITE_SECTORS );           // command
 
   TIMEOUT_CHECK(inportbp(port + 7) != 0x58,TIMEOUT_WARNING(); return -1;);
 
 
   uint32 count2 = (256*num_sectors);
-  if( mode != BD_PIO_NO_IRQ )
-    count2 = 256;
 
   uint32 counter;
   for (counter = 0; counter != count2; counter++) 
@@ -212,67 +273,331 @@ int32 ATADriver::writeSector ( uint32 start_sector, uint32 num_sectors, void * b
 
 uint32 ATADriver::addRequest( BDRequest *br )
 {
-  MutexLock lock(lock_);
-  bool interrupt_context = false;
   debug(ATA_DRIVER, "addRequest %d!\n", br->getCmd() );
-  if( mode != BD_PIO_NO_IRQ )
+  if( br->getCmd() != BDRequest::BD_READ && br->getCmd() != BDRequest::BD_WRITE )
+  {
+    br->setStatus( BDRequest::BD_ERROR );
+    return 0;
+  }
+  if( br->getNumBlocks() == 0 )
+  {
+    br->setStatus( BDRequest::BD_DONE );
+    return 0;
+  }
+
+  if( mode == BD_PIO_NO_IRQ )
+  {
+    debug(ATA_DRIVER, "addRequest:No IRQ operation !!\n");
+    MutexLock lock(lock_);
+    int32 res;
+    if( br->getCmd() == BDRequest::BD_READ )
+      res = readSector( br->getStartBlock(), br->getNumBlocks(), br->getBuffer() );
+    else
+      res = writeSector( br->getStartBlock(), br->getNumBlocks(), br->getBuffer() );
+    br->setStatus( res == 0 ? BDRequest::BD_DONE : BDRequest::BD_ERROR );
+    return 0;
+  }
+
+  // the queue is shared with the interrupt handler
+  bool interrupt_context = ArchInterrupts::disableInterrupts();
+  queueRequest( br );
+  dispatch();
+  if( interrupt_context )
+    ArchInterrupts::enableInterrupts();
+
+  return 0;
+}
+
+void ATADriver::cancelRequest( BDRequest *br )
+{
+  bool interrupt_context = ArchInterrupts::disableInterrupts();
+  if( br->getStatus() == BDRequest::BD_QUEUED )
   {
-    interrupt_context = ArchInterrupts::disableInterrupts();
+    bool active = false;
+    for( BDRequest *it = active_; it; it = it->getNextRequest() )
+      active = active || it == br;
+    for( BDRequest *it = written_; it; it = it->getNextRequest() )
+      active = active || it == br;
 
-    //Add request to the list protected by the cli
-    if( request_list_ == 0 )
-      request_list_ = request_list_tail_ = br;
+    if( active )
+    {
+      debug(ATA_DRIVER, "cancelRequest: active request timed out, resetting controller !!\n");
+      abortActive();
+      dispatch();
+    }
     else
     {
-      request_list_tail_->setNextRequest(br) ;
-      request_list_tail_ = br;
+      BDRequest **link = &request_list_;
+      while( *link && *link != br )
+        link = &(*link)->next_request_;
+      if( *link )
+        *link = br->getNextRequest();
+      br->setNextRequest( 0 );
+      br->setStatus( BDRequest::BD_ERROR );
     }
   }
+  if( interrupt_context )
+    ArchInterrupts::enableInterrupts();
+}
 
-  int32 res = -1;
-  
-  switch( br->getCmd() )
+void ATADriver::queueRequest( BDRequest *br )
+{
+  BDRequest **link = &request_list_;
+  while( *link && (*link)->getStartBlock() <= br->getStartBlock() )
+    link = &(*link)->next_request_;
+  br->setNextRequest( *link );
+  *link = br;
+}
+
+void ATADriver::dispatch()
+{
+  while( !active_ && !flushing_ && request_list_ )
   {
-    case BDRequest::BD_READ:
-      res = readSector( br->getStartBlock(), br->getNumBlocks(), br->getBuffer() );
-      break;
-    case BDRequest::BD_WRITE:
-      res = writeSector( br->getStartBlock(), br->getNumBlocks(), br->getBuffer() );
-      break;
-    default:
-      res = -1;
-      break;
+    // continue in the direction of the last command, start over at the lowest sector at the end
+    BDRequest *prev = 0;
+    BDRequest *br = request_list_;
+    for( BDRequest *it_prev = 0, *it = request_list_; it; it_prev = it, it = it->getNextRequest() )
+    {
+      if( it->getStartBlock() >= head_position_ )
+      {
+        prev = it_prev;
+        br = it;
+        break;
+      }
+    }
+
+    // requests continuing br follow it in the queue
+    uint32 max_sectors = mode == BD_DMA ? ATA_DMA_PAGES * PAGE_SIZE / getSectorSize() : ATA_MAX_SECTORS;
+    uint32 num_sectors = br->getNumBlocks();
+    BDRequest *last = br;
+    for( BDRequest *next = br->getNextRequest();
+         next && next->getCmd() == br->getCmd() && next->getStartBlock() == br->getStartBlock() + num_sectors &&
+         num_sectors + next->getNumBlocks() <= max_sectors;
+         next = next->getNextRequest() )
+    {
+      num_sectors += next->getNumBlocks();
+      last = next;
+    }
+    if( prev )
+      prev->setNextRequest( last->getNextRequest() );
+    else
+      request_list_ = last->getNextRequest();
+    last->setNextRequest( 0 );
+
+    if( last != br )
+      debug(ATA_DRIVER, "dispatch: merged requests into %d sectors from sector %d\n", num_sectors, br->getStartBlock());
+
+    active_ = br;
+    head_position_ = br->getStartBlock() + num_sectors;
+    int32 res;
+    if( mode == BD_DMA && num_sectors <= max_sectors )
+      res = startDMA( num_sectors );
+    else if( br->getCmd() == BDRequest::BD_READ )
+      res = issueCommand( ATA_READ_SECTORS, br->getStartBlock(), num_sectors );
+    else
+      res = startPIOWrite( num_sectors );
+
+    if( res != 0 )
+    {
+      debug(ATA_DRIVER, "dispatch: Got out on error !!\n");
+      while( finishActive( false ) );
+    }
   }
-  
-  if( res != 0 )
+}
+
+bool ATADriver::finishActive( bool success )
+{
+  BDRequest *br = active_;
+  active_ = br->getNextRequest();
+  br->setNextRequest( 0 );
+  if( success && br->getCmd() == BDRequest::BD_WRITE )
   {
-    br->setStatus( BDRequest::BD_ERROR );
-    debug(ATA_DRIVER, "Got out on error !!\n");
-      if( interrupt_context )
-        ArchInterrupts::enableInterrupts();
-    return 0;
+    // completed once the drive has flushed its write cache
+    BDRequest **link = &written_;
+    while( *link )
+      link = &(*link)->next_request_;
+    *link = br;
+    return active_ != 0;
   }
+  // the waiting thread may reuse the request as soon as it is completed
+  br->setStatus( success ? BDRequest::BD_DONE : BDRequest::BD_ERROR );
+  return active_ != 0;
+}
 
-  if( mode == BD_PIO_NO_IRQ )
+void ATADriver::finishCommand()
+{
+  if( !written_ )
   {
-    debug(ATA_DRIVER, "addRequest:No IRQ operation !!\n");
-    br->setStatus( BDRequest::BD_DONE );
-    return 0;
+    dispatch();
+    return;
   }
+  if( issueCommand( ATA_FLUSH_CACHE, 0, 0 ) == 0 )
+  {
+    flushing_ = true;
+    return;
+  }
+  debug(ATA_DRIVER, "finishCommand: could not start FLUSH CACHE !!\n");
+  completeWritten( false );
+  dispatch();
+}
 
-  if (currentThread)
+void ATADriver::completeWritten( bool success )
+{
+  while( written_ )
   {
-    if(interrupt_context)
+    BDRequest *br = written_;
+    written_ = br->getNextRequest();
+    br->setNextRequest( 0 );
+    br->setStatus( success ? BDRequest::BD_DONE : BDRequest::BD_ERROR );
+  }
+}
+
+void ATADriver::abortActive()
+{
+  if( active_dma_ )
+  {
+    outportb( bus_master_port_ + BM_COMMAND, 0 );
+    active_dma_ = false;
+  }
+  outportbp( port + 0x206, 0x04 );
+  outportbp( port + 0x206, 0x00 ); // RESET COTROLLER
+  while( active_ && finishActive( false ) );
+  // the data of the command may not have reached the disk
+  completeWritten( false );
+  flushing_ = false;
+}
+
+bool ATADriver::enableDMA( uint16 bus_master_port )
+{
+  if( !dma_supported_ || mode != BD_PIO )
+  {
+    debug(ATA_DRIVER, "enableDMA: no DMA support or no interrupts, staying with PIO\n");
+    return false;
+  }
+
+  prd_ppn_ = PageManager::instance()->allocPPN();
+  // the bus master only takes 32 bit physical addresses
+  bool addressable = prd_ppn_ < (1U << 20);
+  for( size_t i = 0; i < ATA_DMA_PAGES; i++ )
+  {
+    dma_pages_[i] = PageManager::instance()->allocPPN();
+    addressable = addressable && dma_pages_[i] < (1U << 20);
+  }
+  if( !addressable )
+  {
+    debug(ATA_DRIVER, "enableDMA: DMA buffer above 4 GiB, staying with PIO\n");
+    for( size_t i = 0; i < ATA_DMA_PAGES; i++ )
+      PageManager::instance()->freePPN( dma_pages_[i] );
+    PageManager::instance()->freePPN( prd_ppn_ );
+    prd_ppn_ = 0;
+    return false;
+  }
+  prd_table_ = (PRDEntry *) ArchMemory::getIdentAddressOfPPN( prd_ppn_ );
+
+  bus_master_port_ = bus_master_port;
+  outportb( bus_master_port_ + BM_COMMAND, 0 );
+  outportb( bus_master_port_ + BM_STATUS, inportb( bus_master_port_ + BM_STATUS ) | BM_ERROR | BM_INTERRUPT );
+  mode = BD_DMA;
+  debug(ATA_DRIVER, "enableDMA: using bus master DMA at port %x\n", bus_master_port_);
+  return true;
+}
+
+int32 ATADriver::startDMA( uint32 num_sectors )
+{
+  BDRequest *br = active_;
+  bool read = br->getCmd() == BDRequest::BD_READ;
+  if( !read )
+    copyDMABuffer( true );
+
+  // one region per page, pages never cross the 64 KiB boundaries regions must not cross
+  size_t bytes = num_sectors * getSectorSize();
+  size_t entry = 0;
+  for( ; bytes; entry++ )
+  {
+    size_t chunk = Min( bytes, (size_t) PAGE_SIZE );
+    prd_table_[entry].address = dma_pages_[entry] * PAGE_SIZE;
+    prd_table_[entry].byte_count = chunk;
+    prd_table_[entry].flags = 0;
+    bytes -= chunk;
+  }
+  prd_table_[entry - 1].flags = PRD_END_OF_TABLE;
+
+  uint8 direction = read ? BM_READ : 0;
+  outportb( bus_master_port_ + BM_COMMAND, direction );
+  outportl( bus_master_port_ + BM_PRD_TABLE, prd_ppn_ * PAGE_SIZE );
+  outportb( bus_master_port_ + BM_STATUS, inportb( bus_master_port_ + BM_STATUS ) | BM_ERROR | BM_INTERRUPT );
+
+  if( issueCommand( read ? ATA_READ_DMA : ATA_WRITE_DMA, br->getStartBlock(), num_sectors ) != 0 )
+    return -1;
+
+  active_dma_ = true;
+  outportb( bus_master_port_ + BM_COMMAND, direction | BM_START );
+  return 0;
+}
+
+void ATADriver::copyDMABuffer( bool to_buffer )
+{
+  size_t offset = 0;
+  for( BDRequest *br = active_; br; br = br->getNextRequest() )
+  {
+    char *data = (char *) br->getBuffer();
+    size_t size = br->getNumBlocks() * getSectorSize();
+    for( size_t done = 0; done < size; )
     {
-      currentThread->state_=Sleeping;
-      ArchInterrupts::enableInterrupts();
-      Scheduler::instance()->yield();
+      size_t page_offset = (offset + done) % PAGE_SIZE;
+      size_t chunk = Min( size - done, PAGE_SIZE - page_offset );
+      char *dma = (char *) ArchMemory::getIdentAddressOfPPN( dma_pages_[(offset + done) / PAGE_SIZE] ) + page_offset;
+      if( to_buffer )
+        memcpy( dma, data + done, chunk );
+      else
+        memcpy( data + done, dma, chunk );
+      done += chunk;
     }
-    else
-      currentThread->state_=Sleeping;
+    offset += size;
   }
+}
 
-  return 0;
+int32 ATADriver::startPIOWrite( uint32 num_sectors )
+{
+  if( issueCommand( ATA_WRITE_SECTORS, active_->getStartBlock(), num_sectors ) != 0 )
+    return -1;
+
+  // the first sector is taken without an interrupt, the following ones are requested by one each
+  for( uint32 i = 0; i < ATA_DRQ_POLLS; i++ )
+  {
+    uint8 status = inportbp( port + 0x206 );
+    if( status & ATA_STATUS_BUSY )
+      continue;
+    if( (status & (ATA_STATUS_DRQ | ATA_STATUS_ERROR)) != ATA_STATUS_DRQ )
+      break;
+    writeActiveSector();
+    return 0;
+  }
+  debug(ATA_DRIVER, "startPIOWrite: drive does not take the data\n");
+  return -1;
+}
+
+void ATADriver::finishDMA()
+{
+  uint8 bm_status = inportb( bus_master_port_ + BM_STATUS );
+  if( !(bm_status & BM_INTERRUPT) )
+  {
+    debug(ATA_DRIVER, "finishDMA: IRQ without DMA interrupt!!\n");
+    return;
+  }
+
+  outportb( bus_master_port_ + BM_COMMAND, 0 );
+  outportb( bus_master_port_ + BM_STATUS, bm_status | BM_ERROR | BM_INTERRUPT );
+  uint8 status = inportbp( port + 7 ); // acknowledges the interrupt of the drive
+  active_dma_ = false;
+
+  bool success = !(bm_status & BM_ERROR) && !(status & 0x01);
+  if( !success )
+    debug(ATA_DRIVER, "finishDMA: transfer failed, bus master status %x, status %x\n", bm_status, status);
+  else if( active_->getCmd() == BDRequest::BD_READ )
+    copyDMABuffer( false );
+
+  while( finishActive( success ) );
 }
 
 bool ATADriver::waitForController( bool resetIfFailed = true )
@@ -300,7 +625,19 @@ void ATADriver::serviceIRQ()
   if( mode == BD_PIO_NO_IRQ )
     return;
 
-  if( request_list_ == 0 )
+  if( flushing_ )
+  {
+    uint8 status = inportbp( port + 7 ); // acknowledges the interrupt
+    flushing_ = false;
+    bool success = !(status & (ATA_STATUS_BUSY | ATA_STATUS_ERROR));
+    if( !success )
+      debug(ATA_DRIVER, "serviceIRQ: FLUSH CACHE failed, status %x!!\n", status);
+    completeWritten( success );
+    dispatch();
+    return;
+  }
+
+  if( active_ == 0 )
   {
     debug(ATA_DRIVER, "serviceIRQ: IRQ without request!!\n");
     outportbp( port + 0x206, 0x04 );
@@ -309,77 +646,47 @@ void ATADriver::serviceIRQ()
     return; // not my interrupt
   }
 
-  BDRequest *br = request_list_;
+  if( active_dma_ )
+  {
+    finishDMA();
+    if( !active_ )
+      finishCommand();
+    return;
+  }
+
+  BDRequest *br = active_;
   debug(ATA_DRIVER, "serviceIRQ: Found active request!!\n");
 
-  uint16 *word_buff = (uint16 *) br->getBuffer();
-  uint32 counter;
-  uint32 blocks_done = br->getBlocksDone();
+  uint8 status = inportbp( port + 7 ); // acknowledges the interrupt
+  uint8 expected = ATA_STATUS_DRQ;
+  if( br->getCmd() == BDRequest::BD_WRITE && br->getBlocksDone() + 1 == br->getNumBlocks() && !br->getNextRequest() )
+    expected = 0; // the last sector of a write has been written
+  if( (status & (ATA_STATUS_BUSY | ATA_STATUS_DRQ | ATA_STATUS_ERROR)) != expected )
+  {
+    debug(ATA_DRIVER, "serviceIRQ: unexpected status %x, aborting!!\n", status);
+    abortActive();
+    dispatch();
+    return;
+  }
 
   if( br->getCmd() == BDRequest::BD_READ )
   {
-    if( !waitForController() )
-    {
-      br->setStatus( BDRequest::BD_ERROR );
-      if( br->getThread() )   
-        Scheduler::instance()->wake( br->getThread() );
-      request_list_ = br->getNextRequest();
-      return;
-    }
-
-    for(counter = blocks_done * 256; counter!=(blocks_done + 1) * 256; counter++ )
+    uint16 *word_buff = (uint16 *) br->getBuffer() + br->getBlocksDone() * 256;
+    for( uint32 counter = 0; counter != 256; counter++ )
       word_buff [counter] = inportw ( port );
-
-    blocks_done++;
-    br->setBlocksDone( blocks_done );
-
-    if( blocks_done == br->getNumBlocks() )
-    {
-      br->setStatus( BDRequest::BD_DONE );
-      request_list_ = br->getNextRequest();
-      if( br->getThread() )
-        Scheduler::instance()->wake( br->getThread() );
-    }
   }
-  else if( br->getCmd() == BDRequest::BD_WRITE )
-  {
-    blocks_done++;
-    if( blocks_done == br->getNumBlocks() )
-    {
-      debug(ATA_DRIVER, "serviceIRQ:All done!!\n");
-      br->setStatus( BDRequest::BD_DONE );
-      debug(ATA_DRIVER, "serviceIRQ:Waking up thread!!\n");
-      request_list_ = br->getNextRequest();
 
-      if( br->getThread() )
-        Scheduler::instance()->wake( br->getThread() );
-
-    }
-    else
-    {
-      if( !waitForController() )
-      {
-        br->setStatus( BDRequest::BD_ERROR );
-        if( br->getThread() )
-           Scheduler::instance()->wake( br->getThread() );
-        request_list_ = br->getNextRequest();
-        return;
-      }
-  
-      for(counter = blocks_done*256; counter != (blocks_done + 1) * 256; counter++ )
-        outportw ( port, word_buff [counter] );
-
-      br->setBlocksDone( blocks_done );
-    }
-  }
-  else
+  br->setBlocksDone( br->getBlocksDone() + 1 );
+  if( br->getBlocksDone() == br->getNumBlocks() && !finishActive( true ) )
   {
-    blocks_done = br->getNumBlocks();
-    br->setStatus( BDRequest::BD_ERROR );
-    request_list_ = br->getNextRequest();
-    if( br->getThread() )
-      Scheduler::instance()->wake( br->getThread() );
+    debug(ATA_DRIVER, "serviceIRQ:All done!!\n");
+    finishCommand();
+    return;
   }
 
+  // the next sector may belong to the next request merged into the command
+  if( active_->getCmd() == BDRequest::BD_WRITE )
+    writeActiveSector();
+
   debug(ATA_DRIVER, "serviceIRQ:Request handled!!\n");
 }
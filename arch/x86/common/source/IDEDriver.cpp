@@ -8,6 +8,64 @@
 #include "ArchInterrupts.h"
 #include "kprintf.h"
 
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA 0xCFC
+
+static uint32 pciConfigRead(uint32 bus, uint32 device, uint32 function, uint32 offset)
+{
+  outportl(PCI_CONFIG_ADDRESS, 0x80000000 | (bus << 16) | (device << 11) | (function << 8) | (offset & 0xFC));
+  return inportl(PCI_CONFIG_DATA);
+}
+
+static void pciConfigWrite(uint32 bus, uint32 device, uint32 function, uint32 offset, uint32 value)
+{
+  outportl(PCI_CONFIG_ADDRESS, 0x80000000 | (bus << 16) | (device << 11) | (function << 8) | (offset & 0xFC));
+  outportl(PCI_CONFIG_DATA, value);
+}
+
+bool IDEDriver::findBusMaster(uint16 bus_master_ports[2])
+{
+  for (uint32 bus = 0; bus < 256; ++bus)
+  {
+    for (uint32 device = 0; device < 32; ++device)
+    {
+      for (uint32 function = 0; function < 8; ++function)
+      {
+        uint32 id = pciConfigRead(bus, device, function, 0x00);
+        if ((id & 0xFFFF) == 0xFFFF)
+        {
+          if (function == 0)
+            break;
+          continue;
+        }
+
+        // class 1 (mass storage), subclass 1 (IDE), bit 7 of the programming interface: bus master
+        uint32 class_code = pciConfigRead(bus, device, function, 0x08);
+        uint8 prog_if = (class_code >> 8) & 0xFF;
+        if ((class_code >> 16) != 0x0101 || !(prog_if & 0x80))
+          continue;
+
+        uint32 bar4 = pciConfigRead(bus, device, function, 0x20);
+        if (!(bar4 & 0x1))
+          continue;
+
+        debug(IDE_DRIVER, "findBusMaster: IDE controller %x at %d:%d.%d, bus master port %x\n", id, bus, device,
+              function, bar4 & 0xFFFC);
+        // enable I/O space and bus mastering
+        uint32 command = pciConfigRead(bus, device, function, 0x04);
+        pciConfigWrite(bus, device, function, 0x04, (command & 0xFFFF) | 0x5);
+
+        // channels in native mode do not use the legacy ports the drives are detected at
+        bus_master_ports[0] = (prog_if & 0x1) ? 0 : bar4 & 0xFFFC;
+        bus_master_ports[1] = (prog_if & 0x4) ? 0 : (bar4 & 0xFFFC) + 8;
+        return true;
+      }
+    }
+  }
+  debug(IDE_DRIVER, "findBusMaster: no IDE controller with bus master DMA found\n");
+  return false;
+}
+
 uint32 IDEDriver::doDeviceDetection()
 {
   uint32 jiffies = 0;
@@ -23,6 +81,9 @@ uint32 IDEDriver::doDeviceDetection()
   14, 15, 11, 9
   };
 
+  uint16 bus_master_ports[2] = { 0, 0 };
+  findBusMaster(bus_master_ports);
+
   // setup register values
   devCtrl = 0x00; // please use interrupts
 
@@ -128,6 +189,9 @@ uint32 IDEDriver::doDeviceDetection()
                 debug(IDE_DRIVER, "doDetection: port: %4X, drive: %d \n", base_port, cs % 2);
 
                 ATADriver *drv = new ATADriver(base_port, cs % 2, ata_irqs[cs]);
+                // the bus master of a channel serves one drive, the other one of the channel stays with PIO
+                if (bus_master_ports[cs / 2] && drv->enableDMA(bus_master_ports[cs / 2]))
+                  bus_master_ports[cs / 2] = 0;
                 BDVirtualDevice *bdv = new BDVirtualDevice(drv, 0, drv->getNumSectors(), drv->getSectorSize(), name,
                                                            true);
 
@@ -145,6 +209,9 @@ uint32 IDEDriver::doDeviceDetection()
                 debug(IDE_DRIVER, "doDetection: Running SATA device as PATA in compatibility mode! \n");
 
                 ATADriver *drv = new ATADriver(base_port, cs % 2, ata_irqs[cs]);
+                // the bus master of a channel serves one drive, the other one of the channel stays with PIO
+                if (bus_master_ports[cs / 2] && drv->enableDMA(bus_master_ports[cs / 2]))
+                  bus_master_ports[cs / 2] = 0;
 
                 BDVirtualDevice *bdv = new BDVirtualDevice(drv, 0, drv->getNumSectors(), drv->getSectorSize(), name,
                                                            true);
@@ -54,6 +54,9 @@ const size_t USERTRACE          = Ansi_Red;
 //group memory management
 const size_t PM                 = Ansi_Green | OUTPUT_ENABLED;
 const size_t KMM                = Ansi_Yellow;
+const size_t PAGECACHE          = Ansi_Green;
+const size_t SWAP               = Ansi_Green;
+const size_t KSTACK             = Ansi_Green;
 
 //group driver
 const size_t DRIVER             = Ansi_Yellow;
@@ -75,6 +78,7 @@ const size_t RAMFS              = Ansi_White;
 const size_t DENTRY             = Ansi_Blue;
 const size_t PATHWALKER         = Ansi_Yellow;
 const size_t PSEUDOFS           = Ansi_Yellow;
+const size_t BLOCK_CACHE        = Ansi_Yellow;
 const size_t VFSSYSCALL         = Ansi_Yellow;
 const size_t VFS                = Ansi_Yellow;
 
@@ -0,0 +1,230 @@
+#ifndef BLOCKCACHE_H__
+#define BLOCKCACHE_H__
+
+#include "types.h"
+#include "Mutex.h"
+
+/**
+ * number of hash buckets and the number of buffers kept before the least
+ * recently used unreferenced ones are reused
+ */
+#define BLOCK_CACHE_BUCKETS 128
+#define BLOCK_CACHE_MAX_BUFFERS 512
+
+/**
+ * maximum number of blocks the cache transfers with a single device request
+ */
+#define BLOCK_CACHE_MAX_RUN 32
+
+/**
+ * number of read-ahead requests waiting for the ReadAheadThread, further ones
+ * are dropped
+ */
+#define BLOCK_CACHE_READ_AHEAD_JOBS 8
+
+class BlockCache;
+class ReadAheadThread;
+
+/**
+ * @class BlockBuffer
+ * the cached content of one block of a block device
+ */
+class BlockBuffer
+{
+  public:
+    /**
+     * returns the content of the block, it may only be accessed between
+     * BlockCache::getBlock and BlockCache::releaseBlock
+     */
+    char* getData() { return data_; }
+
+    size_t getBlockSize() { return block_size_; }
+
+    /**
+     * the content has been modified and has to be written back to the device
+     */
+    void markDirty() { dirty_ = true; }
+
+  private:
+    friend class BlockCache;
+
+    BlockBuffer(size_t device, size_t block, size_t block_size);
+    ~BlockBuffer();
+
+    size_t device_;
+    size_t block_;
+    size_t block_size_;
+    char* data_;
+    bool valid_;
+    bool dirty_;
+    size_t ref_count_; // protected by the lock of the cache
+    Mutex lock_; // held by the user of the buffer, protects data_, valid_ and dirty_
+
+    BlockBuffer* hash_next_;
+    BlockBuffer* lru_prev_;
+    BlockBuffer* lru_next_;
+};
+
+/**
+ * @class BlockCache
+ * Caches the blocks of block devices in memory, keyed by device number and
+ * block number. File systems read and modify blocks in the cache instead of
+ * going to the device every time; modified blocks are written back when they
+ * are evicted or the device is flushed.
+ *
+ * The buffers are found via a hash table and kept on a list ordered by their
+ * last use. Once BLOCK_CACHE_MAX_BUFFERS buffers exist, the least recently
+ * used buffer nobody holds a reference to is reused for the next block.
+ */
+class BlockCache
+{
+  public:
+    static BlockCache* instance();
+
+    BlockCache();
+
+    /**
+     * returns the buffer of a block with a reference and its lock held, the buffer
+     * has to be given back with releaseBlock
+     * @param device the device number (see BDManager::getDeviceByNumber)
+     * @param block the block number in units of the block size of the device
+     * @param read false if the caller overwrites the whole block anyway, so the
+     * block does not have to be read from the device on a miss
+     * @return the buffer, its content is zero if reading the block failed
+     */
+    BlockBuffer* getBlock(size_t device, size_t block, bool read = true);
+
+    /**
+     * unlocks a buffer and drops the reference taken by getBlock
+     */
+    void releaseBlock(BlockBuffer* buffer);
+
+    /**
+     * reads consecutive blocks into a buffer. The blocks which are not cached
+     * are read directly into the buffer, a run of them with a single request,
+     * and copied into the cache from there.
+     * @param device the device number
+     * @param block the first block number
+     * @param num_blocks the number of blocks
+     * @param buffer the destination, the blocks which could not be read are zero
+     */
+    void readBlocks(size_t device, size_t block, size_t num_blocks, char* buffer);
+
+    /**
+     * loads the given blocks into the cache unless they are cached already.
+     * Runs of consecutive block numbers are read with a single request.
+     * @param device the device number
+     * @param blocks the block numbers, in the order they are going to be used
+     * @param num_blocks the number of blocks, at most BLOCK_CACHE_MAX_RUN
+     */
+    void prefetchBlocks(size_t device, const size_t* blocks, size_t num_blocks);
+
+    /**
+     * queues the given blocks to be loaded into the cache by the ReadAheadThread
+     * and returns at once. The thread holds the locks of the buffers it is
+     * reading, so a reader of one of the blocks waits until it has arrived.
+     * The blocks are loaded at once before the thread is started, and dropped
+     * if the queue is full.
+     * @param device the device number
+     * @param blocks the block numbers, in the order they are going to be used
+     * @param num_blocks the number of blocks, at most BLOCK_CACHE_MAX_RUN
+     */
+    void readAhead(size_t device, const size_t* blocks, size_t num_blocks);
+
+    /**
+     * starts the ReadAheadThread, the scheduler has to be set up
+     */
+    void startReadAhead();
+
+    /**
+     * loads the blocks of the oldest queued read-ahead, called by the ReadAheadThread
+     */
+    void runReadAhead();
+
+    /**
+     * writes all modified blocks of a device back, runs of consecutive blocks
+     * with a single request
+     * @param device the device number
+     */
+    void flush(size_t device);
+
+    /**
+     * writes all modified blocks of a device back and drops its unused buffers,
+     * e.g. when the file system on the device is unmounted
+     * @param device the device number
+     */
+    void invalidate(size_t device);
+
+    /**
+     * prints the number of cached blocks and the hit rate
+     */
+    void printStatistics();
+
+  private:
+    static size_t hash(size_t device, size_t block);
+
+    /**
+     * returns the buffer of a block, 0 if the block is not cached
+     */
+    BlockBuffer* lookup(size_t device, size_t block);
+
+    /**
+     * returns the buffer of a block with a reference and its lock held like
+     * getBlock, but does not read it if it is not valid
+     */
+    BlockBuffer* getBuffer(size_t device, size_t block);
+
+    /**
+     * returns a new buffer for a block, reusing the least recently used
+     * unreferenced clean buffer if the cache is full
+     */
+    BlockBuffer* allocBuffer(size_t device, size_t block);
+
+    void hashInsert(BlockBuffer* buffer);
+    void hashRemove(BlockBuffer* buffer);
+    void lruRemove(BlockBuffer* buffer);
+    void lruPushFront(BlockBuffer* buffer);
+
+    /**
+     * writes back the buffer allocBuffer would reuse next if it is dirty. lock_
+     * has to be held and is released during the write.
+     * @return true if a buffer has been written back, the caller has to look
+     * the block up again
+     */
+    bool writeBackVictim();
+
+    /**
+     * writes a buffer back if it is dirty, the caller has to own the buffer.
+     * The buffer stays dirty if writing fails.
+     * @return false if writing failed
+     */
+    static bool writeBack(BlockBuffer* buffer);
+
+    BlockBuffer* buckets_[BLOCK_CACHE_BUCKETS];
+    BlockBuffer* lru_head_; // most recently used
+    BlockBuffer* lru_tail_;
+    size_t num_buffers_;
+    size_t hits_;
+    size_t misses_;
+    Mutex lock_;
+
+    struct ReadAheadJob
+    {
+      size_t device_;
+      size_t num_blocks_;
+      size_t blocks_[BLOCK_CACHE_MAX_RUN];
+    };
+
+    /**
+     * the queued read-aheads, a ring of ra_num_jobs_ entries starting at ra_first_job_
+     */
+    ReadAheadJob ra_jobs_[BLOCK_CACHE_READ_AHEAD_JOBS];
+    size_t ra_first_job_;
+    size_t ra_num_jobs_;
+    Mutex ra_lock_; // protects the queue
+    ReadAheadThread* ra_thread_;
+
+    static BlockCache* instance_;
+};
+
+#endif
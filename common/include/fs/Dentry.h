@@ -45,6 +45,11 @@ class Dentry
      */
     Dentry *d_mounts_;
 
+    /**
+     * changes whenever a child is added or removed, see DentryCache
+     */
+    size_t d_generation_;
+
   public:
 
     /**
@@ -97,6 +102,14 @@ class Dentry
       return d_mounts_;
     }
 
+    /**
+     * returns the generation, it changes whenever a child is added or removed
+     */
+    size_t getGeneration()
+    {
+      return d_generation_;
+    }
+
     /**
      * set the mount point
      * @param mount_point the dentry to set the mount point to
@@ -0,0 +1,98 @@
+#ifndef DENTRYCACHE_H__
+#define DENTRYCACHE_H__
+
+#include "types.h"
+#include "ustring.h"
+#ifndef EXE2MINIXFS
+#include "Mutex.h"
+#endif
+
+class Dentry;
+
+/**
+ * number of hash buckets and the maximum number of cached names, the least
+ * recently used entry is reused once all are in use
+ */
+#define DENTRY_CACHE_BUCKETS 128
+#define DENTRY_CACHE_MAX_ENTRIES 512
+
+/**
+ * @class DentryCache
+ * Caches the results of looking up a name in a directory, keyed by the parent
+ * dentry and the name. Names known not to exist are cached as negative entries,
+ * so PathWalker neither has to search the children of a dentry nor go to the
+ * file system for components it has resolved before.
+ *
+ * Entries are not removed when a directory changes. Instead every dentry has
+ * a generation which changes with each added or removed child, and an entry is
+ * only valid while the generation of its parent is the one it was added with.
+ * Generations are unique, so entries of a deleted dentry never match a new
+ * dentry at the same address.
+ */
+class DentryCache
+{
+  public:
+    static DentryCache* instance();
+
+    DentryCache();
+
+    /**
+     * looks up a name in the cache
+     * @param parent the directory dentry
+     * @param name the name
+     * @param dentry returns the dentry of the name, 0 if the name does not exist
+     * @return true if the name is cached, false if it has to be looked up
+     */
+    bool lookup(Dentry* parent, const char* name, Dentry*& dentry);
+
+    /**
+     * adds the result of looking up a name
+     * @param parent the directory dentry
+     * @param name the name
+     * @param dentry the dentry of the name, 0 for a negative entry
+     * @param generation the generation of the parent read before the lookup
+     */
+    void insert(Dentry* parent, const char* name, Dentry* dentry, size_t generation);
+
+    /**
+     * returns a new generation for a dentry
+     */
+    size_t nextGeneration();
+
+    /**
+     * prints the number of cached names and the hit rate
+     */
+    void printStatistics();
+
+  private:
+    struct Entry
+    {
+      Dentry* parent_;
+      size_t generation_;
+      size_t hash_;
+      ustl::string name_;
+      Dentry* dentry_;
+      Entry* hash_next_;
+      Entry* lru_prev_;
+      Entry* lru_next_;
+    };
+
+    static size_t hash(Dentry* parent, const char* name);
+
+    void hashRemove(Entry* entry);
+    void lruRemove(Entry* entry);
+    void lruPushFront(Entry* entry);
+
+    Entry* buckets_[DENTRY_CACHE_BUCKETS];
+    Entry* lru_head_; // most recently used
+    Entry* lru_tail_;
+    size_t num_entries_;
+    size_t generation_;
+    size_t hits_;
+    size_t misses_;
+    Mutex lock_;
+
+    static DentryCache* instance_;
+};
+
+#endif
@@ -2,21 +2,30 @@
 #define FILEDESCRIPTOR_H__
 
 #include "types.h"
-#include "ulist.h"
+#ifndef EXE2MINIXFS
+#include "Mutex.h"
+#endif
 
 class File;
-class FileDescriptor;
 
-extern ustl::list<FileDescriptor*> global_fd;
+/**
+ * number of slots of a file descriptor table, the first three numbers are
+ * reserved for stdin, stdout and stderr
+ */
+#define FD_TABLE_SIZE 128
+#define FD_TABLE_FIRST 3
 
 /**
  * @class FileDescriptor
+ * An opened file. The numbers referring to it are kept in file descriptor
+ * tables, several numbers share one FileDescriptor (and its file position)
+ * after dup, it is closed when the last reference is dropped.
  */
 class FileDescriptor
 {
   protected:
     /**
-     * the file descriptor
+     * the file descriptor number it was opened with
      */
     size_t fd_;
 
@@ -25,9 +34,14 @@ class FileDescriptor
      */
     File* file_;
 
+    /**
+     * the number of table slots and other users referring to it
+     */
+    size_t ref_count_;
+
   public:
     /**
-     * constructor
+     * constructor, the descriptor starts with one reference
      * @param file the file to create the fd for
      */
     FileDescriptor ( File* file );
@@ -38,7 +52,7 @@ class FileDescriptor
     virtual ~FileDescriptor() {}
 
     /**
-     * get the file descriptor
+     * get the file descriptor number it was opened with
      * @return the fd
      */
     uint32 getFd() { return fd_; }
@@ -50,16 +64,103 @@ class FileDescriptor
     File* getFile() { return file_; }
 
     /**
-     * add fd to global fd list
-     * @param fd
+     * takes an additional reference
      */
-    static void add(FileDescriptor* fd);
+    void addRef();
 
     /**
-     * remove fd from global fd list
+     * drops a reference and closes the file via the superblock once the last
+     * one is gone
+     * @param fd the file descriptor
+     */
+    static void release(FileDescriptor* fd);
+
+    /**
+     * enters a newly created fd into the table of the current process
      * @param fd
+     * @return the number of the fd, -1 if the table is full
      */
-    static void remove(FileDescriptor* fd);
+    static int32 add(FileDescriptor* fd);
+};
+
+/**
+ * @class FileDescriptorTable
+ * Maps the file descriptor numbers of a process to its opened files. The
+ * numbers index an array directly, new ones get the lowest free slot.
+ * Only the process itself changes its table, so looking a number up takes
+ * no lock; the lock serializes the kernel threads sharing the kernel table.
+ */
+class FileDescriptorTable
+{
+  public:
+    FileDescriptorTable();
+
+    /**
+     * drops the references of all slots which are still used
+     */
+    ~FileDescriptorTable();
+
+    /**
+     * returns the table of the current thread, threads without an own table
+     * (kernel threads) share the kernel table
+     */
+    static FileDescriptorTable* current();
+
+    /**
+     * returns the fd of a number, 0 if the number is not used
+     * @param fd the file descriptor number
+     */
+    FileDescriptor* get(uint32 fd)
+    {
+      return fd < FD_TABLE_SIZE ? entries_[fd] : 0;
+    }
+
+    /**
+     * enters a fd into the lowest free slot, the reference of the caller is
+     * taken over by the table
+     * @param fd the file descriptor
+     * @return the number of the slot, -1 if the table is full
+     */
+    int32 add(FileDescriptor* fd);
+
+    /**
+     * frees a slot and drops its reference
+     * @param fd the file descriptor number
+     * @return 0 on success, -1 if the number is not used
+     */
+    int32 close(uint32 fd);
+
+    /**
+     * enters the fd of a number a second time, into the lowest free slot
+     * @param fd the file descriptor number
+     * @return the new number, -1 on error
+     */
+    int32 dup(uint32 fd);
+
+    /**
+     * makes new_fd refer to the fd of old_fd, closing new_fd first if it is used
+     * @param old_fd the used file descriptor number
+     * @param new_fd the number to use
+     * @return new_fd, -1 on error
+     */
+    int32 dup2(uint32 old_fd, uint32 new_fd);
+
+  private:
+    FileDescriptorTable(const FileDescriptorTable&);
+
+    /**
+     * enters a fd into the lowest free slot, lock_ has to be held
+     */
+    int32 insert(FileDescriptor* fd);
+
+    FileDescriptor* entries_[FD_TABLE_SIZE];
+
+    /**
+     * no slot below it is free
+     */
+    size_t first_free_;
+
+    Mutex lock_;
 };
 
 #endif // FILEDESCRIPTOR_H_
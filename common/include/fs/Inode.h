@@ -124,6 +124,15 @@ class Inode
       return 0;
     }
 
+    /**
+     * creates the dentries of all children of a directory. File systems which
+     * look up names lazily only have the dentries of the names looked up so
+     * far, so this has to be called before the children are listed.
+     */
+    virtual void loadChildren()
+    {
+    }
+
     /**
      * The link method should make a hard link to the name referred to by the
      * denty, which is in the directory refered to by the Inode.
@@ -83,6 +83,22 @@ class VfsSyscall
      */
     static int32 close(uint32 fd);
 
+    /**
+     * The dup() creates a copy of a file descriptor using the lowest unused
+     * number, both share the file position.
+     * @param fd the file descriptor
+     * @return On success, the new file descriptor is returned. On error, -1 is returned.
+     */
+    static int32 dup(uint32 fd);
+
+    /**
+     * The dup2() makes new_fd a copy of old_fd, closing new_fd first if necessary.
+     * @param old_fd the file descriptor
+     * @param new_fd the file descriptor number to use
+     * @return On success, new_fd is returned. On error, -1 is returned.
+     */
+    static int32 dup2(uint32 old_fd, uint32 new_fd);
+
     /**
      * The read() attempts to read up to count bytes from file descriptor fd
      * into the buffer starting at buffter.
@@ -149,8 +165,8 @@ class VfsSyscall
     static uint32 getFileSize(uint32 fd);
 
     /**
-     * get the File descriptor object from the global variable
-     * @param the fd int
+     * get the File descriptor object from the table of the current process
+     * @param fd the fd int
      * @return the file descriptor object
      */
     static FileDescriptor* getFileDescriptor(uint32 fd);
@@ -44,6 +44,31 @@ class MinixFSFile : public File
      * @return 0 on success
      */
     virtual int32 flush();
+
+  private:
+    /**
+     * reads zones ahead of a sequential reader, the window starts with
+     * READ_AHEAD_MIN_ZONES and doubles with every sequential read up to
+     * READ_AHEAD_MAX_ZONES, a read at any other position resets it
+     * @param position the file position of the read
+     * @param count the number of bytes to read
+     */
+    void readAhead(uint32 position, size_t count);
+
+    /**
+     * the zone a sequential read continues in
+     */
+    uint32 ra_next_zone_;
+
+    /**
+     * the end of the zones read ahead already
+     */
+    uint32 ra_end_zone_;
+
+    /**
+     * number of zones read ahead of the current read, 0 if the reads are not sequential
+     */
+    uint32 ra_window_;
 };
 
 #endif // MinixFSFile_h___
@@ -27,13 +27,14 @@ class MinixFSInode : public Inode
      */
     uint32 i_num_;
 
+  public:
+
     /**
-     * reads all the inode's children from disc and creates their objects
+     * reads all the inode's children from disc and creates their objects,
+     * except for the ones which have been looked up already
      */
     virtual void loadChildren();
 
-  public:
-
     /**
      * basic constructor
      * @param super_block the superblock the inode is on
@@ -60,7 +61,9 @@ class MinixFSInode : public Inode
     /**
      * lookup checks if that name (given by the char-array) exists in the
      * directory (I_DIR inode) and returns the Dentry if it does.
-     * This involves finding and loading the inode. If the lookup failed to find
+     * This involves finding and loading the inode. Unless all children are
+     * loaded, the directory zones are searched for the name and only the inode
+     * of that child is loaded. If the lookup failed to find
      * anything, this is indicated by returning NULL-pointer.
      * @param name the name to look for
      * @return the dentry found or NULL otherwise
@@ -126,6 +129,15 @@ class MinixFSInode : public Inode
      */
     virtual int32 readData(uint32 offset, uint32 size, char *buffer);
 
+    /**
+     * queues the given zones of the file to be loaded into the block cache in
+     * the background, so the following readData calls do not have to wait for
+     * the device
+     * @param start_zone the first zone index within the file
+     * @param num_zones the number of zones, zones beyond the end of the file are skipped
+     */
+    void readAhead(uint32 start_zone, uint32 num_zones);
+
     /**
      * write the data to the inode
      * @param offset offset byte
@@ -141,7 +153,31 @@ class MinixFSInode : public Inode
      */
     virtual int32 flush();
 
+    /**
+     * gives the zones preallocated for writes back to the file system,
+     * called when the file is closed
+     */
+    void releasePreallocation();
+
   private:
+    /**
+     * allocates the next data zone of the file from the preallocation window,
+     * a new window is reserved behind the last zone of the file if it is empty
+     * @param num_zones the number of zones the current write still needs
+     * @return the zone
+     */
+    uint32 allocateDataZone(uint32 num_zones);
+
+    /**
+     * writes a range of the file to its zones, which have to be allocated.
+     * Full zones are written straight from the buffer, partial ones are read
+     * first if they hold data below i_size_.
+     * @param offset the offset in the file
+     * @param size the number of bytes to write
+     * @param buffer the data, 0 to write zeros
+     */
+    void writeRange(uint32 offset, uint32 size, const char* buffer);
+
     /**
      * writes the inode dentry to disc
      * @param dest_i_num the inode number to write the dentry to
@@ -157,11 +193,38 @@ class MinixFSInode : public Inode
      */
     int32 findDentry(uint32 i_num);
 
+    /**
+     * searches the directory zones for a name and loads the child
+     * @param name the name to look for
+     * @return the new dentry of the child, 0 if there is no such name
+     */
+    Dentry* loadChild(const char* name);
+
+    /**
+     * loads the inode of a directory entry and creates the dentry for it
+     * @param i_num the inode number of the entry
+     * @param entry_name the name of the entry, at most MAX_NAME_LENGTH characters
+     * @return the new dentry, 0 if the inode is not in use
+     */
+    Dentry* addChild(uint16 i_num, const char* entry_name);
+
     /**
      * true if the inodes children are allready loaded
      */
     bool children_loaded_;
 
+    /**
+     * the zones reserved for this file on writes, so it stays contiguous
+     * when other files are written at the same time
+     */
+    uint32 prealloc_zone_;
+    uint32 prealloc_count_;
+
+    /**
+     * the next inode in the same bucket of the inode hash of the superblock
+     */
+    MinixFSInode* hash_next_;
+
     ustl::list<Dentry*> other_dentries_;
 
 };
@@ -3,7 +3,11 @@
 
 #include "Superblock.h"
 #include "MinixStorageManager.h"
-#include "umap.h"
+
+/**
+ * number of hash buckets of the loaded inodes of a file system
+ */
+#define INODE_HASH_BUCKETS 64
 
 class Inode;
 class MinixFSInode;
@@ -82,6 +86,20 @@ class MinixFSSuperblock : public Superblock
      */
     void all_inodes_remove_inode(Inode* inode);
 
+    /**
+     * puts an inode on the dirty_inodes_ list, so it is written to the file
+     * system with the next writeDirtyInodes
+     * @param inode the modified inode
+     */
+    void markInodeDirty(MinixFSInode* inode);
+
+    /**
+     * writes all inodes on the dirty_inodes_ list. Inodes of one inode table
+     * block end up in the same block cache buffer, so each block is written
+     * back once when the cache is flushed.
+     */
+    void writeDirtyInodes();
+
     /**
      * create a file with the given flag and a file descriptor with the given inode.
      * @param inode the inode to link the file with
@@ -96,6 +114,15 @@ class MinixFSSuperblock : public Superblock
      */
     virtual uint16 allocateZone();
 
+    /**
+     * allocates a run of consecutive zones on the file system
+     * @param goal the zone the run should start at, 0 for no goal
+     * @param max_zones the maximum number of zones
+     * @param num_zones returns the number of zones allocated, at least 1
+     * @return the first zone index
+     */
+    uint16 allocateZones(uint16 goal, uint32 max_zones, uint32& num_zones);
+
     /**
      * frees zone on the file system
      * @param index the zone index
@@ -122,6 +149,26 @@ class MinixFSSuperblock : public Superblock
      */
     MinixFSInode *getInode(uint16 i_num, bool &is_already_loaded);
 
+    /**
+     * returns the loaded inode with the given number
+     * @param i_num the inode number
+     * @return the inode, 0 if it is not loaded
+     */
+    MinixFSInode *lookupInode(uint32 i_num);
+
+    /**
+     * returns the block of the inode table the given inode is stored in
+     * @param i_num the inode number
+     */
+    uint32 getInodeBlock(uint32 i_num);
+
+    /**
+     * loads the inode table blocks of the given inodes into the block cache
+     * @param i_nums the inode numbers, 0 entries are skipped
+     * @param num_inodes the number of inode numbers
+     */
+    void readAheadInodes(const uint16* i_nums, uint32 num_inodes);
+
     /**
      * reads one Zone from the file system to the given buffer
      * @param zone the zone index to read
@@ -129,6 +176,15 @@ class MinixFSSuperblock : public Superblock
      */
     void readZone(uint16 zone, char *buffer);
 
+    /**
+     * reads consecutive zones from the file system to the given buffer,
+     * with a single device request for the zones which are not cached
+     * @param zone the index of the first zone to read
+     * @param num_zones the number of zones to read
+     * @param buffer the buffer to write in
+     */
+    void readZones(uint16 zone, uint32 num_zones, char *buffer);
+
     /**
      * reads the given number of blocks from the file system to the given buffer
      * @param block the index of the block to start reading
@@ -137,12 +193,29 @@ class MinixFSSuperblock : public Superblock
      */
     void readBlocks(uint16 block, uint32 num_blocks, char *buffer);
 
+    /**
+     * loads the given blocks into the block cache
+     * @param blocks the block numbers
+     * @param num_blocks the number of blocks, at most READ_AHEAD_MAX_ZONES
+     * @param wait false to only queue the blocks for the ReadAheadThread
+     * (see BlockCache::readAhead)
+     */
+    void readAheadBlocks(const size_t* blocks, uint32 num_blocks, bool wait = true);
+
     /**
      * writes one zone from the given buffer to the file system
      * @param zone the zone index to write
      * @param buffer the buffer to write
      */
-    void writeZone(uint16 zone, char *buffer);
+    void writeZone(uint16 zone, const char *buffer);
+
+    /**
+     * writes consecutive zones from the given buffer to the file system
+     * @param zone the index of the first zone to write
+     * @param num_zones the number of zones to write
+     * @param buffer the buffer to write
+     */
+    void writeZones(uint16 zone, uint32 num_zones, const char *buffer);
 
     /**
      * writes the given number of blcoks to the file system from the given buffer
@@ -150,7 +223,7 @@ class MinixFSSuperblock : public Superblock
      * @param num_blocks the number of blocks to write
      * @param buffer the buffer to write
      */
-    void writeBlocks(uint16 block, uint32 num_blocks, char *buffer);
+    void writeBlocks(uint16 block, uint32 num_blocks, const char *buffer);
 
     /**
      * writes the given number of bytes to the filesystem
@@ -224,7 +297,10 @@ class MinixFSSuperblock : public Superblock
     uint64 offset_;
 
 
-    ustl::map<uint32, Inode*> all_inodes_set_;
+    /**
+     * the loaded inodes hashed by their number, chained via MinixFSInode::hash_next_
+     */
+    MinixFSInode* inode_hash_[INODE_HASH_BUCKETS];
 
     /**
      * pointer to self for compatability
@@ -13,6 +13,8 @@ class MinixFSSuperblock;
  * the first 7 are directly addressed to its first 7 zones
  * the 8th is the address of a zone containing the zone addresses 8 to 520
  * the 9th is the address of a zone containing the zone addresses for further zones containg the addresses 520 to 262,664
+ * the zones containing zone addresses are not kept in memory, their entries are read and
+ * written through the superblock and thereby through the block cache when they are used
  */
 class MinixFSZone
 {
@@ -72,11 +74,37 @@ class MinixFSZone
 
   private:
 
+    /**
+     * returns an entry of a zone containing zone addresses
+     * @param table the zone containing the addresses
+     * @param index the index of the entry
+     * @return the zone address
+     */
+    uint32 getTableEntry(uint32 table, uint32 index);
+
+    /**
+     * sets an entry of a zone containing zone addresses
+     * @param table the zone containing the addresses
+     * @param index the index of the entry
+     * @param zone the zone address
+     */
+    void setTableEntry(uint32 table, uint32 index, uint32 zone);
+
+    /**
+     * allocates a zone for zone addresses and clears it
+     * @return the zone
+     */
+    uint32 allocateTable();
+
+    /**
+     * counts the used entries of a zone containing zone addresses
+     * @param table the zone containing the addresses
+     * @return the number of entries which are not 0
+     */
+    uint32 countTableEntries(uint32 table);
+
     MinixFSSuperblock *superblock_;
     uint32 direct_zones_[10];
-    uint32 *indirect_zones_;
-    uint32 *double_indirect_linking_zone_;
-    uint32 **double_indirect_zones_;
 
     uint32 num_zones_;
 
@@ -39,6 +39,18 @@ class MinixStorageManager : public StorageManager
      */
     virtual size_t allocZone();
 
+    /**
+     * allocates a run of consecutive free zones. The run starts at the goal if
+     * it is free, otherwise at the first free run of max_zones zones after the
+     * goal or, if there is none, the first free zone after it.
+     * @param goal the zone index the run should start at, e.g. the one following
+     * the last zone of a file, 0 for no goal
+     * @param max_zones the maximum length of the run
+     * @param num_zones returns the length of the run, at least 1
+     * @return the index of the first zone of the run
+     */
+    size_t allocZones(size_t goal, size_t max_zones, size_t& num_zones);
+
     /**
      * returns the next free inode index and sets it as used
      * @return the inode index
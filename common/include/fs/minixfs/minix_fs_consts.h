@@ -14,5 +14,8 @@
 #define MAX_NAME_LENGTH ((superblock_->s_magic_==MINIX_V3) ? 60 : 30)
 #define NUM_ZONES ((superblock_->s_magic_==MINIX_V3) ? 10 : 9)
 #define MINIX_V3 0x4d5a
+#define READ_AHEAD_MIN_ZONES 4
+#define READ_AHEAD_MAX_ZONES 32
+#define PREALLOC_ZONES 8
 
 #endif
@@ -0,0 +1,46 @@
+#ifndef COMPLETION_H__
+#define COMPLETION_H__
+
+#include "types.h"
+
+class Thread;
+
+/**
+ * @class Completion
+ * A one-shot event a single thread waits for, e.g. the end of a block device
+ * request. The waiting thread sleeps until complete() is called, which is
+ * allowed from interrupt handlers, so it uses no cpu time and is woken up
+ * exactly once.
+ */
+class Completion
+{
+  public:
+    Completion();
+
+    /**
+     * sleeps until complete() has been called, returns at once if it has been
+     * called already. Interrupts are enabled while sleeping and restored afterwards.
+     * Without a current thread (during boot) the completion is polled instead,
+     * at most IO_TIMEOUT times.
+     * @param timeout_ticks the maximum number of timer ticks to sleep, 0 for no limit
+     * @return true if complete() has been called, false on timeout
+     */
+    bool wait(size_t timeout_ticks = 0);
+
+    /**
+     * marks the completion as done and wakes up the waiting thread,
+     * may be called from interrupt handlers
+     */
+    void complete();
+
+    /**
+     * returns true if complete() has been called
+     */
+    bool isDone();
+
+  private:
+    volatile size_t done_;
+    Thread* volatile waiter_;
+};
+
+#endif
@@ -45,8 +45,9 @@ class Condition : public Lock
     /**
      * Wakes up the first Thread on the sleepers list.
      * If the list is empty, signal is being lost.
+     * @return the thread woken up, 0 if nobody was waiting
      */
-    void signal(const char* debug_info = 0);
+    Thread* signal(const char* debug_info = 0);
 
     /**
      * Wakes up all Threads on the sleepers list.
@@ -11,24 +11,72 @@
 #include "Mutex.h"
 #include "ArchMemory.h"
 #include "ElfFormat.h"
+#include "VmaTree.h"
 #include <uvector.h>
 
 class Stabs2DebugInfo;
+class File;
+class FileDescriptor;
+class Inode;
+
+/**
+ * memory protection and mapping flags of mmap, they have to match sys/mman.h of the userspace libc
+ */
+#define PROT_NONE     0x00000000
+#define PROT_READ     0x00000001
+#define PROT_WRITE    0x00000002
+
+#define MAP_PRIVATE   0x00000000
+#define MAP_SHARED    0x40000000
+#define MAP_ANONYMOUS 0x80000000
+
+#define MS_ASYNC      0x00000001
+#define MS_SYNC       0x00000004
+
+/**
+ * memory mappings are placed top down between these two addresses,
+ * well above the binary and below the stack
+ */
+#define MMAP_AREA_START 0x40000000U
+#define MMAP_AREA_END   0x70000000U
+
+/**
+ * user stacks are placed top down below USER_STACK_END, each one reserves
+ * LOADER_STACK_LIMIT bytes which are mapped on demand when the stack grows,
+ * and is separated from the next one by LOADER_STACK_GUARD_PAGES unmapped pages
+ */
+#define USER_STACK_END           0x80000000U
+#define LOADER_STACK_LIMIT       (8U * 1024U * 1024U)
+#define LOADER_STACK_GUARD_PAGES 16
+
+/**
+ * a page fault in the executable loads all pages of the surrounding (aligned)
+ * window of LOADER_FAULT_AROUND_PAGES pages of the faulting segment at once
+ */
+#define LOADER_FAULT_AROUND_PAGES 8
+
+/**
+ * set to 1 to load all pages of the executable when the process is created
+ * instead of on demand
+ */
+#define LOADER_EAGER_LOAD 0
 
 /**
 * @class Loader manages the Addressspace creation of a thread
 */
 class Loader
 {
+  friend class SwapManager;
+
   public:
 
     /**
      *Constructor
-     * @param fd the file descriptor of the executable
+     * @param file_descriptor the opened executable, the loader takes an own reference
      * @param thread Thread to which the loader should belong
      * @return Loader instance
      */
-    Loader(ssize_t fd, Thread *thread);
+    Loader(FileDescriptor* file_descriptor, Thread *thread);
 
     /**
      *Destructor
@@ -36,9 +84,23 @@ class Loader
     ~Loader();
 
     /**
-     *Creates a new PageDirectory and a new Page for the stack and initialises them
+     *Creates the stack of the first thread and maps its top page
+     * @return the top of the stack, 0 on failure
+     */
+    pointer initUserspaceAddressSpace();
+
+    /**
+     * reserves a stack which grows on demand up to the given size
+     * @param limit maximum size of the stack in bytes
+     * @return the top of the stack (exclusive), 0 if there is no space left
+     */
+    pointer allocateStack(size_t limit);
+
+    /**
+     * unmaps a stack allocated with allocateStack and releases its address range
+     * @param stack_top the top of the stack as returned by allocateStack
      */
-    void initUserspaceAddressSpace();
+    void releaseStack(pointer stack_top);
 
     /**
      *Initialises the Addressspace of the User, creates the Thread's
@@ -49,11 +111,51 @@ class Loader
     bool loadExecutableAndInitProcess();
 
     /**
-     *loads one page slow by its virtual address: gets a free page, maps it,
-     *zeros it out, copies the page, one byte at a time
-     * @param virtual_address virtual address where to find the page to load
+     * resolves a userspace page fault through the memory area containing the
+     * faulting address, e.g. by loading a page of the binary, serving a page of
+     * a memory mapping or mapping a zeroed heap or stack page
+     * @param address the faulting virtual address
+     * @param present true if the page was present (protection fault)
+     * @param writing true if the fault was caused by a write access
+     * @return true if the fault was resolved, false if the access is not allowed
+     */
+    bool handlePageFault(pointer address, bool present, bool writing);
+
+    /**
+     * maps a file (or anonymous memory) into the address space
+     * @param length length of the mapping in bytes
+     * @param prot PROT_READ and/or PROT_WRITE
+     * @param flags MAP_SHARED or MAP_PRIVATE, optionally MAP_ANONYMOUS
+     * @param fd the file descriptor of the mapped file
+     * @param offset page aligned offset within the file
+     * @return the start address of the mapping, 0 on failure
+     */
+    pointer mmap(size_t length, size_t prot, size_t flags, size_t fd, size_t offset);
+
+    /**
+     * removes all mappings within the given range, modified pages of shared
+     * file mappings are written back
+     * @param start page aligned start address
+     * @param length length of the range in bytes
+     * @return 0 on success, -1 on failure
+     */
+    int32 munmap(pointer start, size_t length);
+
+    /**
+     * writes modified pages of shared file mappings within the given range back to their files
+     * @param start page aligned start address
+     * @param length length of the range in bytes
+     * @return 0 on success, -1 on failure
      */
-    void loadOnePageSafeButSlow ( pointer virtual_address );
+    int32 msync(pointer start, size_t length);
+
+    /**
+     * sets the end of the heap (program break), the heap starts at the first page
+     * after the binary and its pages are mapped and zeroed on demand
+     * @param end the new end of the heap, 0 only queries the current end
+     * @return the new end of the heap, the old one if it cannot be moved there
+     */
+    pointer brk(pointer end);
 
     /**
      * Returns debug info for the loaded userspace program, if available
@@ -78,13 +180,126 @@ class Loader
 
     bool readFromBinary (char* buffer, l_off_t position, size_t count);
 
+    /**
+     * reads from a position of the executable
+     * @return the number of bytes read, -1 on error
+     */
+    ssize_t readFile(char* buffer, l_off_t position, size_t count);
+
+    /**
+     * a PT_LOAD segment of the executable, the bytes between file_end and mem_end are bss
+     */
+    struct LoadSegment
+    {
+      pointer start;
+      pointer file_end;
+      pointer mem_end;
+      size_t file_offset;
+      bool writeable;
+    };
+
+    /**
+     * returns the first segment ending above the given address (binary search), 0 if there is none
+     */
+    LoadSegment* findSegment(pointer address);
+
+    /**
+     * returns true if the page belongs to a segment and has not been loaded yet
+     */
+    bool isExecutablePage(size_t virtual_page);
+
+    /**
+     * returns true if the page is a read-only page of the executable which can be mapped
+     * directly from the PageCache and thereby shared with all processes running the executable,
+     * i.e. the whole page is file content of the segment
+     * @param file_page set to the page number within the file
+     */
+    bool isSharedTextPage(size_t virtual_page, size_t& file_page);
+
+    /**
+     * loads the pages of the executable within the given page range which have not
+     * been loaded yet, using one read per segment, load_lock_ has to be held
+     * @return false if reading the executable failed
+     */
+    bool loadExecutablePages(size_t first_page, size_t end_page);
+
+    /**
+     * loads the page of the executable (and its neighbours) containing the given address,
+     * kills the process if that fails, load_lock_ has to be held
+     */
+    void loadExecutablePage(pointer virtual_address);
+
+    /**
+     * registers a private page of this address space with the SwapManager (if swapping is enabled)
+     */
+    void makeSwappable(size_t virtual_page, size_t ppn);
+
+    /**
+     * reads a swapped out page back from the swap partition and maps it, load_lock_ has to be held
+     * @return false if the page is not swapped out
+     */
+    bool swapInPage(size_t virtual_page);
+
+    /**
+     * maps a page of a memory mapping, load_lock_ has to be held
+     * @return false if the access violates the protection of the mapping
+     */
+    bool loadMappedPage(VirtualMemoryArea& mapping, size_t virtual_page, bool present, bool writing);
+
+    /**
+     * writes back the dirty pages of a shared file mapping within the given page range,
+     * does nothing for other memory areas
+     */
+    void syncMapping(VirtualMemoryArea& mapping, size_t first_page, size_t end_page);
+
+    /**
+     * unmaps all pages within the given page range and shrinks, splits or removes
+     * the affected memory areas, load_lock_ has to be held
+     */
+    void unmapRange(size_t first_page, size_t end_page);
+
+    /**
+     * unmaps the pages within the given page range and frees their swap slots,
+     * load_lock_ has to be held
+     */
+    void unmapPages(size_t first_page, size_t end_page);
+
+    /**
+     * maps a zeroed page, load_lock_ has to be held
+     */
+    void mapZeroPage(size_t virtual_page);
+
 
-    size_t fd_;
+    /**
+     * the opened executable, the loader holds a reference to it
+     */
+    FileDescriptor* file_descriptor_;
     Thread *thread_;
     Elf::Ehdr *hdr_;
     ustl::vector<Elf::Phdr> phdrs_;
+
+    /**
+     * loadable segments sorted by their start address, they do not overlap
+     */
+    ustl::vector<LoadSegment> segments_;
+
+    /**
+     * the inode of the executable, it stays alive as long as file_descriptor_ is open
+     */
+    Inode* inode_;
     Mutex load_lock_;
 
+    /**
+     * the memory areas of the address space: executable, heap, stacks and memory mappings
+     */
+    VmaTree vmas_;
+
+    /**
+     * start (page aligned, right after the binary) and current end of the heap
+     */
+    pointer heap_start_;
+    pointer heap_break_;
+
     Stabs2DebugInfo *userspace_debug_info_;
 
 };
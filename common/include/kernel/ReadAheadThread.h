@@ -0,0 +1,18 @@
+#ifndef READAHEADTHREAD_H_
+#define READAHEADTHREAD_H_
+
+#include "Thread.h"
+
+/**
+ * @class ReadAheadThread
+ * kernel thread which loads the blocks queued with BlockCache::readAhead
+ * into the block cache, so sequential readers do not wait for the device
+ */
+class ReadAheadThread : public Thread
+{
+  public:
+    ReadAheadThread();
+    virtual void Run();
+};
+
+#endif /* READAHEADTHREAD_H_ */
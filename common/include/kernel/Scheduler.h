@@ -60,6 +60,14 @@ class Scheduler
      */
     void yield();
 
+    /**
+     * forces a task switch and hands the cpu to the given thread if it is
+     * schedulable, e.g. a consumer which has just been woken up by its producer
+     * (see FiFo::put)
+     * @param thread the thread to run next
+     */
+    void yieldTo(Thread* thread);
+
     /**
      * prints a List of all Threads using kprintfd
      */
@@ -109,6 +117,11 @@ class Scheduler
      */
     void incTicks();
 
+    /**
+     * returns the ticks value stored
+     */
+    uint32 getTicks();
+
   protected:
     friend class IdleThread;
     friend class CleanupThread;
@@ -117,11 +130,6 @@ class Scheduler
      * it removes and deletes Threads in state ToBeDestroyed
      */
     void cleanupDeadThreads();
-
-    /**
-     * returns the ticks value stored
-     */
-    uint32 getTicks();
     
   private:
     Scheduler();
@@ -148,6 +156,8 @@ class Scheduler
 
     size_t ticks_;
 
+    Thread* handoff_thread_; // run next by schedule(), set by yieldTo
+
     IdleThread idle_thread_;
     CleanupThread cleanup_thread_;
 };
@@ -0,0 +1,18 @@
+#ifndef SWAPTHREAD_H_
+#define SWAPTHREAD_H_
+
+#include "Thread.h"
+
+/**
+ * @class SwapThread
+ * kernel thread which swaps out pages in the background,
+ * it is woken up by the PageManager when free pages run low
+ */
+class SwapThread : public Thread
+{
+  public:
+    SwapThread();
+    virtual void Run();
+};
+
+#endif /* SWAPTHREAD_H_ */
@@ -92,6 +92,25 @@ class Syscall
  */
   static size_t close(size_t fd);
 
+/**
+ * duplicates a file descriptor of the calling process
+ *
+ * @pre IF==1
+ * @param fd File-Descriptor the process has opened
+ * @return the lowest unused file descriptor, now referring to the same file, -1 upon error
+ */
+  static size_t dup(size_t fd);
+
+/**
+ * makes a file descriptor number refer to the file of another one
+ *
+ * @pre IF==1
+ * @param old_fd File-Descriptor the process has opened
+ * @param new_fd the number to use, it is closed first if it is open
+ * @return new_fd, -1 upon error
+ */
+  static size_t dup2(size_t old_fd, size_t new_fd);
+
 /**
  * open is a basic example of a method handling the open syscall
  *
@@ -112,8 +131,48 @@ class Syscall
  */
   static size_t createprocess(size_t path, size_t sleep);
 
+/**
+ * maps a file or anonymous memory into the address space of the calling process
+ *
+ * @pre IF==1
+ * @pre args < 2gb
+ * @param args pointer to the six arguments of mmap (start, length, prot, flags, fd, offset),
+ *        they do not fit into the five syscall arguments
+ * @return the start address of the mapping, -1 upon error
+ */
+  static size_t mmap(size_t args);
+
+/**
+ * removes the memory mappings within the given range
+ *
+ * @pre IF==1
+ * @param start page aligned start address
+ * @param length length of the range in bytes
+ * @return -1 upon error, 0 otherwise
+ */
+  static size_t munmap(size_t start, size_t length);
+
+/**
+ * writes back modified pages of shared file mappings within the given range
+ *
+ * @pre IF==1
+ * @param start page aligned start address
+ * @param length length of the range in bytes
+ * @param flags MS_SYNC or MS_ASYNC, both write back synchronously
+ * @return -1 upon error, 0 otherwise
+ */
+  static size_t msync(size_t start, size_t length, size_t flags);
+
+/**
+ * moves the end of the heap of the calling process
+ *
+ * @pre IF==1
+ * @param end the new end of the heap, 0 to query the current end
+ * @return the new end of the heap, the unchanged one if it cannot be moved
+ */
+  static size_t brk(size_t end);
+
   //static size_t clone();
-  //static size_t brk(..);
   //static void waitpid();
   //static size_t open(...);
   //static void close(...);
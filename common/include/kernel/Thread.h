@@ -17,6 +17,7 @@ extern SystemState system_state;
 class Thread;
 class ArchThreadInfo;
 class Loader;
+class FileDescriptorTable;
 class Terminal;
 class Mutex;
 class FsWorkingDirectory;
@@ -41,6 +42,12 @@ class Thread
 
     virtual ~Thread();
 
+    /**
+     * thread objects are recycled by the ThreadCache
+     */
+    static void* operator new(size_t size);
+    static void operator delete(void* thread, size_t size);
+
     /**
      * Marks the thread to be deleted by the scheduler.
      * DO Not use new / delete in this Method, as it sometimes called from an Interrupt Handler with Interrupts disabled
@@ -54,7 +61,11 @@ class Thread
 
     ArchThreadInfo *kernel_arch_thread_info_;
     ArchThreadInfo *user_arch_thread_info_;
-    uint32 stack_[2048];
+    /**
+     * lowest word of the kernel stack, holds the stack canary;
+     * the stack comes from the KernelStackManager
+     */
+    uint32* stack_;
 
     uint32 switch_to_userspace_;
 
@@ -62,8 +73,19 @@ class Thread
 
     Loader *loader_;
 
+    /**
+     * the file descriptors opened by the process, 0 for kernel threads, which
+     * use the kernel table
+     */
+    FileDescriptorTable *fd_table_;
+
     ThreadState state_;
 
+    /**
+     * timer tick at which the scheduler wakes up the sleeping thread, 0 for none
+     */
+    size_t wakeup_tick_;
+
     const char *getName()
     {
       return name_.c_str();
@@ -0,0 +1,80 @@
+#ifndef THREADCACHE_H__
+#define THREADCACHE_H__
+
+#include "types.h"
+#include "Mutex.h"
+
+struct ArchThreadInfo;
+
+/**
+ * number of dead thread objects kept for new threads, every thread has up to
+ * two ArchThreadInfos, so twice as many of them are kept
+ */
+#define THREAD_CACHE_SIZE 16
+
+/**
+ * @class ThreadCache
+ * Recycles the memory of dead threads. Thread objects and ArchThreadInfos
+ * freed by the cleanup thread are kept on free lists instead of going back
+ * to the KernelMemoryManager, new threads take them from there.
+ * Thread objects are only reused for threads of the same size, i.e. mostly of
+ * the same class. (The kernel stacks are recycled by the KernelStackManager.)
+ */
+class ThreadCache
+{
+  public:
+    static ThreadCache* instance();
+
+    ThreadCache();
+
+    /**
+     * returns memory for a thread object, called by Thread::operator new
+     * @param size the size of the thread object
+     */
+    void* allocThread(size_t size);
+
+    /**
+     * takes back the memory of a destroyed thread object, called by Thread::operator delete
+     * @param thread the memory of the thread object
+     * @param size the size of the thread object
+     */
+    void freeThread(void* thread, size_t size);
+
+    /**
+     * returns memory for an ArchThreadInfo, it has to be initialised by the caller
+     */
+    ArchThreadInfo* allocThreadInfo();
+
+    /**
+     * takes back an ArchThreadInfo which is not used anymore
+     */
+    void freeThreadInfo(ArchThreadInfo* info);
+
+    /**
+     * prints the hit rates of the free lists
+     */
+    void printStatistics();
+
+  private:
+    struct CachedThread
+    {
+      void* memory;
+      size_t size;
+    };
+
+    CachedThread threads_[THREAD_CACHE_SIZE];
+    size_t num_threads_;
+    ArchThreadInfo* infos_[2 * THREAD_CACHE_SIZE];
+    size_t num_infos_;
+
+    size_t thread_hits_;
+    size_t thread_misses_;
+    size_t info_hits_;
+    size_t info_misses_;
+
+    Mutex lock_;
+
+    static ThreadCache* instance_;
+};
+
+#endif
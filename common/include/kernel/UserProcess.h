@@ -4,6 +4,7 @@
 #include "Thread.h"
 
 class ProcessRegistry;
+class FileDescriptor;
 
 /**
  * @class UserProcess
@@ -32,7 +33,11 @@ class UserProcess : public Thread
 
     bool run_me_;
     uint32 terminal_number_;
-    int32 fd_;
+
+    /**
+     * the executable, referenced without a number in any file descriptor table
+     */
+    FileDescriptor* file_descriptor_;
     ProcessRegistry *process_registry_;
 };
 
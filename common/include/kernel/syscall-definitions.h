@@ -44,6 +44,9 @@
 //....
 #define sc_reboot 88
 //....
+#define sc_mmap 90
+#define sc_munmap 91
+//....
 #define sc_outline 105
 //....
 #define sc_ipc 117
@@ -5,6 +5,11 @@
 #include "Mutex.h"
 #include "assert.h"
 
+/**
+ * number of pages ksbrk allocates and maps at once when the kernel heap grows
+ */
+#define KSBRK_BATCH_PAGES 16
+
 /**
  * @class MallocSegment
  *
@@ -0,0 +1,73 @@
+#ifndef KERNELSTACKMANAGER_H__
+#define KERNELSTACKMANAGER_H__
+
+#include "types.h"
+#include "paging-definitions.h"
+#include "Mutex.h"
+
+class Bitmap;
+
+/**
+ * size of a kernel stack and of the unmapped guard gap below it
+ */
+#define KERNEL_STACK_PAGES 2
+#define KERNEL_STACK_GUARD_PAGES 1
+#define KERNEL_STACK_SIZE (KERNEL_STACK_PAGES * PAGE_SIZE)
+
+/**
+ * number of freed stacks which stay mapped for the next threads
+ */
+#define KERNEL_STACK_CACHE_SIZE 16
+
+/**
+ * @class KernelStackManager
+ * Hands out the kernel stacks of threads. The stacks live in a dedicated
+ * virtual area of the kernel (ArchMemory::KERNEL_STACKS_START to
+ * ArchMemory::KERNEL_STACKS_END) which is divided into slots of
+ * KERNEL_STACK_GUARD_PAGES unmapped guard pages followed by the
+ * KERNEL_STACK_PAGES pages of the stack, so running over the end of a stack
+ * faults instead of overwriting the memory below.
+ *
+ * Freed stacks stay mapped in a small cache, creating a thread after another
+ * one has died neither allocates physical pages nor touches the page tables.
+ */
+class KernelStackManager
+{
+  public:
+    static KernelStackManager* instance();
+
+    KernelStackManager();
+
+    /**
+     * returns the lowest address of a mapped kernel stack of KERNEL_STACK_SIZE bytes
+     */
+    pointer allocStack();
+
+    /**
+     * gives a stack back, it must not be in use anymore
+     * @param stack the lowest address of the stack as returned by allocStack
+     */
+    void freeStack(pointer stack);
+
+    /**
+     * returns the number of freed stacks which are still mapped
+     */
+    size_t getNumCachedStacks();
+
+  private:
+    /**
+     * returns the first virtual page of the stack in the given slot
+     */
+    static size_t getStackPage(size_t slot);
+
+    size_t num_slots_;
+    size_t next_slot_;
+    Bitmap* used_slots_; // slots in use or cached
+    size_t cached_slots_[KERNEL_STACK_CACHE_SIZE];
+    size_t num_cached_;
+    Mutex lock_;
+
+    static KernelStackManager* instance_;
+};
+
+#endif
@@ -0,0 +1,111 @@
+#ifndef PAGECACHE_H__
+#define PAGECACHE_H__
+
+#include "types.h"
+#include "Mutex.h"
+#include "Condition.h"
+#include "umap.h"
+
+class Inode;
+
+/**
+ * @class PageCache
+ * Caches the content of files page by page in physical pages, so that
+ * memory mapped files can be mapped directly into the address spaces of
+ * processes. Every inode has its own set of cached pages.
+ *
+ * The cache holds one reference (see PageManager::refPPN) to every cached
+ * page; every address space mapping the page holds another one, so pages
+ * stay alive as long as they are mapped anywhere. Clean pages only the
+ * cache holds are freed again when memory runs low (see reclaim).
+ */
+class PageCache
+{
+  public:
+    static PageCache *instance();
+
+    PageCache();
+
+    /**
+     * returns the physical page caching the given page of an inode and loads
+     * it from the file system on a cache miss. Bytes beyond the end of the
+     * file are zero.
+     * The page is read without holding the lock of the cache, other threads
+     * asking for the same page wait until it has been read.
+     * The caller gets an additional reference to the page, which has to be
+     * dropped with PageManager::freePPN (e.g. by unmapping the page).
+     * @param inode the inode
+     * @param page_index page number within the file (file offset / PAGE_SIZE)
+     * @return the physical page number
+     */
+    uint32 getPage(Inode* inode, uint32 page_index);
+
+    /**
+     * marks a cached page as modified, it will be written back on the next writeBack
+     * @param inode the inode
+     * @param page_index page number within the file
+     */
+    void markDirty(Inode* inode, uint32 page_index);
+
+    /**
+     * writes the dirty cached pages of the given range back to the file system
+     * @param inode the inode
+     * @param first_page first page number within the file
+     * @param num_pages number of pages
+     */
+    void writeBack(Inode* inode, uint32 first_page, uint32 num_pages);
+
+    /**
+     * keeps the cached pages coherent with data written through write()
+     * @param inode the inode written to
+     * @param offset the file offset of the written data
+     * @param size number of bytes written
+     * @param buffer the written data
+     */
+    void updateFromWrite(Inode* inode, uint32 offset, uint32 size, const char* buffer);
+
+    /**
+     * drops all pages cached for an inode, has to be called before the inode is destroyed
+     * @param inode the inode
+     */
+    void invalidateInode(Inode* inode);
+
+    /**
+     * frees clean cached pages which are not mapped anywhere, called by the
+     * swap thread when free pages run low. Nothing is freed if the cache is
+     * busy, its user might be waiting for free pages itself.
+     * @param max_pages the maximum number of pages to free
+     * @return the number of pages freed
+     */
+    uint32 reclaim(uint32 max_pages);
+
+    /**
+     * returns the number of pages currently cached
+     */
+    uint32 getNumCachedPages();
+
+  private:
+    struct CachedPage
+    {
+      uint32 ppn;
+      bool dirty;
+      bool loading; // the page is being read from the file system
+      bool stale; // written to while loading, has to be read again
+    };
+
+    typedef ustl::map<uint32, CachedPage> InodePages;
+
+    /**
+     * returns the cached pages of an inode, 0 if nothing is cached
+     */
+    InodePages* getInodePages(Inode* inode);
+
+    ustl::map<Inode*, InodePages*> inodes_;
+    uint32 num_cached_pages_;
+    Mutex lock_;
+    Condition page_loaded_; // signalled when a page has been loaded
+
+    static PageCache* instance_;
+};
+
+#endif
@@ -18,20 +18,42 @@ class PageManager
      */
     uint32 getTotalNumPages() const;
 
+    /**
+     * returns the number of currently free 4k Pages
+     */
+    uint32 getNumFreePages() const;
+
     /**
      * returns the number of the lowest free Page
      * and marks that Page as used.
+     * If there is no free page left and a swap partition is available,
+     * the calling thread waits until the swap thread has freed some pages.
      * returns always 4kb ppns!
      */
     uint32 allocPPN(uint32 page_size = PAGE_SIZE);
 
     /**
-     * marks physical page <page_number> as free, if it was used in
-     * user or kernel space.
+     * drops one reference to physical page <page_number> and marks it as free,
+     * if it was used in user or kernel space and this was the last reference.
      * @param page_number Physcial Page to mark as unused
      */
     void freePPN(uint32 page_number, uint32 page_size = PAGE_SIZE);
 
+    /**
+     * adds a reference to an already allocated physical page, e.g. if the page
+     * is mapped into another address space or held by the page cache.
+     * Every reference has to be dropped with freePPN.
+     * @param page_number the allocated page
+     */
+    void refPPN(uint32 page_number);
+
+    /**
+     * returns the number of references to an allocated physical page
+     * @param page_number the page
+     * @return the number of references, 0 if the page is free
+     */
+    uint32 getRefCount(uint32 page_number);
+
     Thread* heldBy()
     {
       return lock_.heldBy();
@@ -56,6 +78,12 @@ class PageManager
     PageManager(PageManager const&);
 
     Bitmap* page_usage_table_;
+
+    /**
+     * reference counts of the allocated pages,
+     * 0 for pages which are in use but have never been allocated by allocPPN (treated as 1)
+     */
+    uint16* page_ref_counts_;
     uint32 number_of_pages_;
     uint32 lowest_unreserved_page_;
 
@@ -0,0 +1,150 @@
+#ifndef SWAPMANAGER_H__
+#define SWAPMANAGER_H__
+
+#include "types.h"
+#include "Mutex.h"
+#include "Condition.h"
+
+class BDVirtualDevice;
+class Bitmap;
+class Loader;
+class Thread;
+class SwapThread;
+
+/**
+ * partition type of linux swap partitions, the first of them is used for swapping
+ */
+#define SWAP_PARTITION_TYPE 0x82
+
+/**
+ * the swap thread is woken up when less than SWAP_LOW_WATERMARK pages are free
+ * and swaps out pages until SWAP_HIGH_WATERMARK pages are free
+ */
+#define SWAP_LOW_WATERMARK  64
+#define SWAP_HIGH_WATERMARK 128
+
+/**
+ * maximum number of threads which can wait for free pages at the same time
+ */
+#define SWAP_MAX_WAITERS 16
+
+/**
+ * @class SwapManager
+ * Swaps anonymous userspace pages out to a swap partition when physical memory
+ * runs low. Every swappable physical page has a reverse mapping to the Loader
+ * (address space) and virtual page it is mapped to. Pages to swap out are
+ * chosen by a clock (second chance) scan over the physical pages using the
+ * accessed flags of the page tables. The scan runs in the SwapThread, which
+ * first frees the clean PageCache pages nobody maps.
+ */
+class SwapManager
+{
+  public:
+    /**
+     * returns the swap manager, 0 if no swap partition is available
+     */
+    static SwapManager* instance();
+
+    /**
+     * looks for a swap partition and starts the swap thread,
+     * has to be called after the block devices have been detected
+     */
+    static void init();
+
+    /**
+     * makes a physical page mapped into a userspace address space swappable
+     * @param ppn the physical page, it must only be mapped at this place
+     * @param owner the loader of the address space
+     * @param virtual_page the virtual page the physical page is mapped to
+     */
+    void addPage(uint32 ppn, Loader* owner, size_t virtual_page);
+
+    /**
+     * forgets all pages and frees all swap slots of an address space,
+     * has to be called before the address space is destroyed
+     * @param owner the loader of the address space
+     */
+    void removeAddressSpace(Loader* owner);
+
+    /**
+     * reads a swapped out page and frees its swap slot
+     * @param swap_slot the swap slot
+     * @param ppn the physical page to read into
+     * @return true on success
+     */
+    bool swapIn(size_t swap_slot, uint32 ppn);
+
+    /**
+     * frees the swap slot of a swapped out page which is not needed anymore
+     * @param swap_slot the swap slot
+     */
+    void freeSlot(size_t swap_slot);
+
+    /**
+     * wakes up the swap thread
+     */
+    void wakeUp();
+
+    /**
+     * lets the calling thread wait until the swap thread has tried to free pages
+     * @return false if waiting is not possible (e.g. the caller holds the lock of
+     * the kernel memory manager) or no page could be freed
+     */
+    bool waitForFreePages();
+
+    /**
+     * swaps out pages until SWAP_HIGH_WATERMARK pages are free or no page is left to swap out,
+     * called by the swap thread
+     */
+    void reclaim();
+
+    /**
+     * returns the number of free swap slots
+     */
+    uint32 getNumFreeSlots();
+
+  private:
+    SwapManager(BDVirtualDevice* device);
+
+    /**
+     * swaps out a page if it has not been accessed since the last scan, lock_
+     * has to be held and is released while the page is written out
+     * @return true if the page has been swapped out and freed
+     */
+    bool reclaimPage(uint32 ppn);
+
+    /**
+     * returns a free swap slot, 0 if the swap partition is full
+     */
+    size_t allocSlot();
+
+    bool isWaiting(Thread* thread);
+
+    struct ReverseMapping
+    {
+      Loader* owner;
+      size_t virtual_page;
+    };
+
+    BDVirtualDevice* device_;
+    Bitmap* slots_;
+    Loader** slot_owners_;
+    ReverseMapping* rmap_;
+    uint32 num_pages_;
+    uint32 clock_hand_;
+    Mutex lock_;
+
+    /**
+     * broadcast at the end of every pass of reclaim
+     */
+    Condition pass_done_;
+    bool reclaiming_;
+    SwapThread* swap_thread_;
+    Thread* waiters_[SWAP_MAX_WAITERS];
+    volatile size_t reclaim_passes_;
+    volatile size_t last_num_reclaimed_;
+
+    static SwapManager* instance_;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef VMATREE_H__
+#define VMATREE_H__
+
+#include "types.h"
+#include "uvector.h"
+
+class File;
+
+/**
+ * kinds of virtual memory areas
+ */
+#define VMA_ELF   0 // pages of the executable
+#define VMA_HEAP  1 // anonymous memory up to the program break
+#define VMA_STACK 2 // anonymous memory of a user stack
+#define VMA_MMAP  3 // a memory mapping created by mmap, file backed or anonymous
+
+/**
+ * a region of an address space, all pages of the region are handled the same way on page faults
+ */
+struct VirtualMemoryArea
+{
+  size_t start_page;
+  size_t end_page; // exclusive
+  size_t kind;
+  size_t prot; // PROT_READ and/or PROT_WRITE
+  size_t flags; // MAP_SHARED and/or MAP_ANONYMOUS, only for VMA_MMAP
+  File* file; // backing file of VMA_MMAP areas, 0 for anonymous memory
+  size_t file_page; // page number within the file of start_page
+};
+
+/**
+ * @class VmaTree
+ * The virtual memory areas of an address space, sorted by their start page.
+ * The areas do not overlap, so they are sorted by their end pages as well and
+ * lookups are binary searches.
+ */
+class VmaTree
+{
+  public:
+    /**
+     * returns the area containing the given page, 0 if there is none
+     */
+    VirtualMemoryArea* find(size_t virtual_page);
+
+    /**
+     * returns the index of the first area ending above the given page,
+     * size() if there is none
+     */
+    size_t lowerBound(size_t virtual_page);
+
+    /**
+     * returns true if no area overlaps the given page range
+     */
+    bool isFree(size_t start_page, size_t end_page);
+
+    /**
+     * inserts a new area, it must not be empty or overlap with another one
+     */
+    void insert(const VirtualMemoryArea& area);
+
+    /**
+     * removes the area with the given index
+     */
+    void erase(size_t index);
+
+    /**
+     * looks for the highest free range of num_pages pages between low_page and high_page,
+     * which keeps a distance of guard_pages pages to the areas below and above it
+     * @return the start page of the range, 0 if there is none
+     */
+    size_t findFreeRange(size_t num_pages, size_t low_page, size_t high_page, size_t guard_pages);
+
+    size_t size() const { return areas_.size(); }
+
+    VirtualMemoryArea& operator[](size_t index) { return areas_[index]; }
+
+  private:
+    ustl::vector<VirtualMemoryArea> areas_;
+};
+
+#endif
@@ -4,6 +4,8 @@
 #include "new.h"
 #include "Mutex.h"
 #include "Condition.h"
+#include "Scheduler.h"
+#include "ArchInterrupts.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -116,10 +118,13 @@ void FiFo<T>::put(T c)
       while (ib_write_pos_ == ib_read_pos_)
         space_to_write_.wait();
   }
-  something_to_read_.signal();
+  Thread* reader = something_to_read_.signal();
   input_buffer_[ib_write_pos_++] = c;
   ib_write_pos_ %= input_buffer_size_;
   input_buffer_lock_.release();
+  // a reader waiting for input gets it at once instead of at the next timer tick
+  if (reader && ArchInterrupts::testIFSet())
+    Scheduler::instance()->yieldTo(reader);
 }
 
 template<class T>
@@ -3,6 +3,8 @@
 #include "KeyboardManager.h"
 #include "Scheduler.h"
 #include "PageManager.h"
+#include "BlockCache.h"
+#include "DentryCache.h"
 
 Console* main_console;
 
@@ -43,6 +45,8 @@ void Console::handleKey(uint32 key)
   {
     case KEY_F8:
       PageManager::instance()->printBitmap();
+      BlockCache::instance()->printStatistics();
+      DentryCache::instance()->printStatistics();
       break;
 
     case KEY_F9:
@@ -0,0 +1,435 @@
+#include "BlockCache.h"
+#include "ReadAheadThread.h"
+#include "Scheduler.h"
+#include "BDManager.h"
+#include "BDVirtualDevice.h"
+#include "MutexLock.h"
+#include "kprintf.h"
+#include "kstring.h"
+#include "assert.h"
+#include "debug.h"
+#include "uvector.h"
+
+BlockBuffer::BlockBuffer(size_t device, size_t block, size_t block_size) :
+    device_(device), block_(block), block_size_(block_size), data_(new char[block_size]), valid_(false),
+    dirty_(false), ref_count_(0), lock_("BlockBuffer::lock_"), hash_next_(0), lru_prev_(0), lru_next_(0)
+{
+}
+
+BlockBuffer::~BlockBuffer()
+{
+  assert(ref_count_ == 0);
+  delete[] data_;
+}
+
+BlockCache* BlockCache::instance_ = 0;
+
+BlockCache* BlockCache::instance()
+{
+  if (unlikely(!instance_))
+    instance_ = new BlockCache();
+  return instance_;
+}
+
+BlockCache::BlockCache() :
+    lru_head_(0), lru_tail_(0), num_buffers_(0), hits_(0), misses_(0), lock_("BlockCache::lock_"),
+    ra_first_job_(0), ra_num_jobs_(0), ra_lock_("BlockCache::ra_lock_"), ra_thread_(0)
+{
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+size_t BlockCache::hash(size_t device, size_t block)
+{
+  return (block + device * 31) % BLOCK_CACHE_BUCKETS;
+}
+
+BlockBuffer* BlockCache::lookup(size_t device, size_t block)
+{
+  for (BlockBuffer* buffer = buckets_[hash(device, block)]; buffer; buffer = buffer->hash_next_)
+  {
+    if (buffer->device_ == device && buffer->block_ == block)
+      return buffer;
+  }
+  return 0;
+}
+
+void BlockCache::hashInsert(BlockBuffer* buffer)
+{
+  size_t bucket = hash(buffer->device_, buffer->block_);
+  buffer->hash_next_ = buckets_[bucket];
+  buckets_[bucket] = buffer;
+}
+
+void BlockCache::hashRemove(BlockBuffer* buffer)
+{
+  BlockBuffer** link = &buckets_[hash(buffer->device_, buffer->block_)];
+  while (*link != buffer)
+  {
+    assert(*link && "BlockCache::hashRemove: buffer is not in the hash table");
+    link = &(*link)->hash_next_;
+  }
+  *link = buffer->hash_next_;
+  buffer->hash_next_ = 0;
+}
+
+void BlockCache::lruRemove(BlockBuffer* buffer)
+{
+  if (buffer->lru_prev_)
+    buffer->lru_prev_->lru_next_ = buffer->lru_next_;
+  else
+    lru_head_ = buffer->lru_next_;
+  if (buffer->lru_next_)
+    buffer->lru_next_->lru_prev_ = buffer->lru_prev_;
+  else
+    lru_tail_ = buffer->lru_prev_;
+  buffer->lru_prev_ = buffer->lru_next_ = 0;
+}
+
+void BlockCache::lruPushFront(BlockBuffer* buffer)
+{
+  buffer->lru_prev_ = 0;
+  buffer->lru_next_ = lru_head_;
+  if (lru_head_)
+    lru_head_->lru_prev_ = buffer;
+  else
+    lru_tail_ = buffer;
+  lru_head_ = buffer;
+}
+
+bool BlockCache::writeBack(BlockBuffer* buffer)
+{
+  if (!buffer->dirty_)
+    return true;
+  BDVirtualDevice* bdvd = BDManager::getInstance()->getDeviceByNumber(buffer->device_);
+  if (bdvd->writeData(buffer->block_ * buffer->block_size_, buffer->block_size_, buffer->data_)
+      != (int32) buffer->block_size_)
+  {
+    debug(BLOCK_CACHE, "writeBack: writing block %d of device %d failed\n", buffer->block_, buffer->device_);
+    return false;
+  }
+  buffer->dirty_ = false;
+  return true;
+}
+
+bool BlockCache::writeBackVictim()
+{
+  if (num_buffers_ < BLOCK_CACHE_MAX_BUFFERS)
+    return false;
+  BlockBuffer* victim = lru_tail_;
+  while (victim && victim->ref_count_)
+    victim = victim->lru_prev_;
+  if (!victim || !victim->dirty_)
+    return false;
+
+  // the reference keeps the buffer from being reused while lock_ is dropped
+  ++victim->ref_count_;
+  lock_.release("BlockCache::writeBackVictim");
+  victim->lock_.acquire("BlockCache::writeBackVictim");
+  bool written = writeBack(victim);
+  victim->lock_.release("BlockCache::writeBackVictim");
+  lock_.acquire("BlockCache::writeBackVictim");
+  --victim->ref_count_;
+  if (!written)
+  {
+    // try other buffers first next time
+    lruRemove(victim);
+    lruPushFront(victim);
+  }
+  return written;
+}
+
+BlockBuffer* BlockCache::allocBuffer(size_t device, size_t block)
+{
+  size_t block_size = BDManager::getInstance()->getDeviceByNumber(device)->getBlockSize();
+  if (num_buffers_ >= BLOCK_CACHE_MAX_BUFFERS)
+  {
+    for (BlockBuffer* victim = lru_tail_; victim; victim = victim->lru_prev_)
+    {
+      // dirty buffers could not be written back, they are kept until a flush succeeds
+      if (victim->ref_count_ || victim->dirty_)
+        continue;
+      // nobody holds a reference, so nobody holds its lock either
+      hashRemove(victim);
+      lruRemove(victim);
+      if (victim->block_size_ == block_size)
+      {
+        victim->device_ = device;
+        victim->block_ = block;
+        victim->valid_ = false;
+        return victim;
+      }
+      delete victim;
+      --num_buffers_;
+      break;
+    }
+  }
+  ++num_buffers_;
+  return new BlockBuffer(device, block, block_size);
+}
+
+BlockBuffer* BlockCache::getBuffer(size_t device, size_t block)
+{
+  lock_.acquire("BlockCache::getBuffer");
+  BlockBuffer* buffer;
+  // writing a victim back drops lock_, somebody else might have added the block meanwhile
+  while (!(buffer = lookup(device, block)) && writeBackVictim());
+  if (buffer)
+  {
+    ++hits_;
+    lruRemove(buffer);
+  }
+  else
+  {
+    ++misses_;
+    buffer = allocBuffer(device, block);
+    hashInsert(buffer);
+  }
+  lruPushFront(buffer);
+  ++buffer->ref_count_;
+  lock_.release("BlockCache::getBuffer");
+
+  buffer->lock_.acquire("BlockCache::getBuffer");
+  return buffer;
+}
+
+BlockBuffer* BlockCache::getBlock(size_t device, size_t block, bool read)
+{
+  BlockBuffer* buffer = getBuffer(device, block);
+  if (!buffer->valid_)
+  {
+    if (!read)
+      buffer->valid_ = true;
+    else if (BDManager::getInstance()->getDeviceByNumber(device)->readData(block * buffer->block_size_,
+                                                                            buffer->block_size_, buffer->data_)
+             == (int32) buffer->block_size_)
+      buffer->valid_ = true;
+    else
+    {
+      debug(BLOCK_CACHE, "getBlock: reading block %d of device %d failed\n", block, device);
+      memset(buffer->data_, 0, buffer->block_size_);
+    }
+  }
+  return buffer;
+}
+
+void BlockCache::readBlocks(size_t device, size_t block, size_t num_blocks, char* buffer)
+{
+  BDVirtualDevice* bdvd = BDManager::getInstance()->getDeviceByNumber(device);
+  size_t block_size = bdvd->getBlockSize();
+  BlockBuffer* buffers[BLOCK_CACHE_MAX_RUN];
+  for (size_t done = 0; done < num_blocks;)
+  {
+    // the buffers are locked in ascending block order, like flush does
+    size_t chunk = Min(num_blocks - done, BLOCK_CACHE_MAX_RUN);
+    for (size_t i = 0; i < chunk; ++i)
+      buffers[i] = getBuffer(device, block + done + i);
+    char* chunk_data = buffer + done * block_size;
+    size_t next;
+    for (size_t first = 0; first < chunk; first = next)
+    {
+      next = first + 1;
+      if (buffers[first]->valid_)
+      {
+        memcpy(chunk_data + first * block_size, buffers[first]->data_, block_size);
+        continue;
+      }
+      for (; next < chunk && !buffers[next]->valid_; ++next);
+      size_t run_size = (next - first) * block_size;
+      char* run = chunk_data + first * block_size;
+      if (bdvd->readData((block + done + first) * block_size, run_size, run) == (int32) run_size)
+      {
+        for (size_t i = first; i < next; ++i)
+        {
+          memcpy(buffers[i]->data_, run + (i - first) * block_size, block_size);
+          buffers[i]->valid_ = true;
+        }
+      }
+      else
+      {
+        debug(BLOCK_CACHE, "readBlocks: reading %d blocks from block %d of device %d failed\n", next - first,
+              block + done + first, device);
+        memset(run, 0, run_size);
+      }
+    }
+    for (size_t i = 0; i < chunk; ++i)
+      releaseBlock(buffers[i]);
+    done += chunk;
+  }
+}
+
+void BlockCache::prefetchBlocks(size_t device, const size_t* blocks, size_t num_blocks)
+{
+  assert(num_blocks <= BLOCK_CACHE_MAX_RUN);
+  BlockBuffer* missing[BLOCK_CACHE_MAX_RUN];
+  size_t num_missing = 0;
+  lock_.acquire("BlockCache::prefetchBlocks");
+  for (size_t i = 0; i < num_blocks; ++i)
+  {
+    BlockBuffer* cached;
+    while (!(cached = lookup(device, blocks[i])) && writeBackVictim());
+    if (cached)
+      continue;
+    BlockBuffer* buffer = allocBuffer(device, blocks[i]);
+    hashInsert(buffer);
+    lruPushFront(buffer);
+    ++buffer->ref_count_;
+    // a new buffer, so its lock is free
+    buffer->lock_.acquire("BlockCache::prefetchBlocks");
+    missing[num_missing++] = buffer;
+  }
+  lock_.release("BlockCache::prefetchBlocks");
+
+  BDVirtualDevice* bdvd = BDManager::getInstance()->getDeviceByNumber(device);
+  size_t next;
+  for (size_t first = 0; first < num_missing; first = next)
+  {
+    size_t block_size = missing[first]->block_size_;
+    for (next = first + 1; next < num_missing && missing[next]->block_ == missing[next - 1]->block_ + 1; ++next);
+    size_t run_size = (next - first) * block_size;
+    char* run = next - first == 1 ? missing[first]->data_ : new char[run_size];
+    if (bdvd->readData(missing[first]->block_ * block_size, run_size, run) == (int32) run_size)
+    {
+      for (size_t i = first; i < next; ++i)
+      {
+        if (run != missing[i]->data_)
+          memcpy(missing[i]->data_, run + (i - first) * block_size, block_size);
+        missing[i]->valid_ = true;
+      }
+    }
+    else
+      debug(BLOCK_CACHE, "prefetchBlocks: reading %d blocks from block %d of device %d failed\n", next - first,
+            missing[first]->block_, device);
+    if (run != missing[first]->data_)
+      delete[] run;
+  }
+  for (size_t i = 0; i < num_missing; ++i)
+    releaseBlock(missing[i]);
+}
+
+void BlockCache::readAhead(size_t device, const size_t* blocks, size_t num_blocks)
+{
+  assert(num_blocks <= BLOCK_CACHE_MAX_RUN);
+  if (!ra_thread_)
+  {
+    prefetchBlocks(device, blocks, num_blocks);
+    return;
+  }
+  MutexLock lock(ra_lock_);
+  if (ra_num_jobs_ == BLOCK_CACHE_READ_AHEAD_JOBS)
+  {
+    debug(BLOCK_CACHE, "readAhead: queue full, dropping %d blocks of device %d\n", num_blocks, device);
+    return;
+  }
+  ReadAheadJob& job = ra_jobs_[(ra_first_job_ + ra_num_jobs_) % BLOCK_CACHE_READ_AHEAD_JOBS];
+  job.device_ = device;
+  job.num_blocks_ = num_blocks;
+  memcpy(job.blocks_, blocks, num_blocks * sizeof(size_t));
+  ++ra_num_jobs_;
+  ra_thread_->addJob();
+}
+
+void BlockCache::startReadAhead()
+{
+  assert(!ra_thread_);
+  ReadAheadThread* thread = new ReadAheadThread();
+  Scheduler::instance()->addNewThread(thread);
+  ra_thread_ = thread;
+}
+
+void BlockCache::runReadAhead()
+{
+  ReadAheadJob job;
+  ra_lock_.acquire("BlockCache::runReadAhead");
+  assert(ra_num_jobs_);
+  job = ra_jobs_[ra_first_job_];
+  ra_first_job_ = (ra_first_job_ + 1) % BLOCK_CACHE_READ_AHEAD_JOBS;
+  --ra_num_jobs_;
+  ra_lock_.release("BlockCache::runReadAhead");
+  prefetchBlocks(job.device_, job.blocks_, job.num_blocks_);
+}
+
+void BlockCache::releaseBlock(BlockBuffer* buffer)
+{
+  assert(buffer);
+  buffer->lock_.release("BlockCache::releaseBlock");
+  MutexLock lock(lock_);
+  assert(buffer->ref_count_ > 0);
+  --buffer->ref_count_;
+}
+
+void BlockCache::flush(size_t device)
+{
+  ustl::vector<BlockBuffer*> dirty_buffers;
+  lock_.acquire("BlockCache::flush");
+  for (BlockBuffer* buffer = lru_head_; buffer; buffer = buffer->lru_next_)
+  {
+    if (buffer->device_ == device && buffer->dirty_)
+    {
+      ++buffer->ref_count_;
+      // keep the list sorted by block number, so runs of consecutive blocks can be found
+      ustl::vector<BlockBuffer*>::iterator it = dirty_buffers.begin();
+      while (it != dirty_buffers.end() && (*it)->block_ < buffer->block_)
+        ++it;
+      dirty_buffers.insert(it, buffer);
+    }
+  }
+  lock_.release("BlockCache::flush");
+
+  BDVirtualDevice* bdvd = BDManager::getInstance()->getDeviceByNumber(device);
+  size_t next;
+  for (size_t first = 0; first < dirty_buffers.size(); first = next)
+  {
+    BlockBuffer* first_buffer = dirty_buffers[first];
+    first_buffer->lock_.acquire("BlockCache::flush");
+    for (next = first + 1; next < dirty_buffers.size() && next - first < BLOCK_CACHE_MAX_RUN
+                           && dirty_buffers[next]->block_ == dirty_buffers[next - 1]->block_ + 1; ++next)
+      dirty_buffers[next]->lock_.acquire("BlockCache::flush");
+    if (next - first == 1)
+      writeBack(first_buffer);
+    else
+    {
+      size_t block_size = first_buffer->block_size_;
+      size_t run_size = (next - first) * block_size;
+      char* run = new char[run_size];
+      for (size_t i = first; i < next; ++i)
+        memcpy(run + (i - first) * block_size, dirty_buffers[i]->data_, block_size);
+      if (bdvd->writeData(first_buffer->block_ * block_size, run_size, run) == (int32) run_size)
+      {
+        for (size_t i = first; i < next; ++i)
+          dirty_buffers[i]->dirty_ = false;
+      }
+      else
+        debug(BLOCK_CACHE, "flush: writing %d blocks from block %d of device %d failed\n", next - first,
+              first_buffer->block_, device);
+      delete[] run;
+    }
+    for (size_t i = first; i < next; ++i)
+      releaseBlock(dirty_buffers[i]);
+  }
+  debug(BLOCK_CACHE, "flush: wrote back %d blocks of device %d\n", dirty_buffers.size(), device);
+}
+
+void BlockCache::invalidate(size_t device)
+{
+  flush(device);
+  MutexLock lock(lock_);
+  BlockBuffer* previous;
+  for (BlockBuffer* buffer = lru_tail_; buffer; buffer = previous)
+  {
+    previous = buffer->lru_prev_;
+    // flush wrote everything back it could, modified blocks are not dropped
+    if (buffer->device_ != device || buffer->ref_count_ || buffer->dirty_)
+      continue;
+    hashRemove(buffer);
+    lruRemove(buffer);
+    delete buffer;
+    --num_buffers_;
+  }
+}
+
+void BlockCache::printStatistics()
+{
+  size_t lookups = hits_ + misses_;
+  kprintfd("BlockCache: %d blocks cached, %d of %d lookups hit (%d%%)\n", num_buffers_, hits_, lookups,
+           lookups ? hits_ * 100 / lookups : 0);
+}
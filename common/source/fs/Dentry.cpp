@@ -1,17 +1,19 @@
 #include "Dentry.h"
 #include "assert.h"
 #include "Inode.h"
+#include "DentryCache.h"
 
 #include "kprintf.h"
 
 Dentry::Dentry(const char* name) :
-    d_inode_(0), d_parent_(this), d_mounts_(0), d_name_(name)
+    d_inode_(0), d_parent_(this), d_mounts_(0), d_generation_(DentryCache::instance()->nextGeneration()), d_name_(name)
 {
   debug(DENTRY, "created Dentry with Name %s\n", name);
 }
 
 Dentry::Dentry(Dentry *parent) :
-    d_inode_(0), d_parent_(parent), d_mounts_(0), d_name_("NamELLEss")
+    d_inode_(0), d_parent_(parent), d_mounts_(0), d_generation_(DentryCache::instance()->nextGeneration()),
+    d_name_("NamELLEss")
 {
   parent->setChild(this);
 }
@@ -38,6 +40,7 @@ void Dentry::childInsert(Dentry *child_dentry)
 {
   assert(child_dentry != 0);
   d_child_.push_back(child_dentry);
+  d_generation_ = DentryCache::instance()->nextGeneration();
 }
 
 int32 Dentry::childRemove(Dentry *child_dentry)
@@ -46,6 +49,7 @@ int32 Dentry::childRemove(Dentry *child_dentry)
         ustl::find(d_child_.begin(), d_child_.end(), child_dentry) != d_child_.end());
   assert(child_dentry != 0);
   d_child_.remove(child_dentry);
+  d_generation_ = DentryCache::instance()->nextGeneration();
   child_dentry->d_parent_ = 0;
   debug(DENTRY, "Dentry childRemove remove == 0\n");
   return 0;
@@ -62,6 +66,7 @@ int32 Dentry::setChild(Dentry *dentry)
     return -1;
 
   d_child_.push_back(dentry);
+  d_generation_ = DentryCache::instance()->nextGeneration();
 
   return 0;
 }
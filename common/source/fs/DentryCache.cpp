@@ -0,0 +1,127 @@
+#include "DentryCache.h"
+#include "Dentry.h"
+#include "kstring.h"
+#include "kprintf.h"
+#include "assert.h"
+#ifndef EXE2MINIXFS
+#include "MutexLock.h"
+#endif
+
+DentryCache* DentryCache::instance_ = 0;
+
+DentryCache* DentryCache::instance()
+{
+  if (!instance_)
+    instance_ = new DentryCache();
+  return instance_;
+}
+
+DentryCache::DentryCache() :
+    lru_head_(0), lru_tail_(0), num_entries_(0), generation_(0), hits_(0), misses_(0), lock_("DentryCache::lock_")
+{
+  memset(buckets_, 0, sizeof(buckets_));
+}
+
+size_t DentryCache::hash(Dentry* parent, const char* name)
+{
+  size_t hash = (size_t) parent;
+  for (; *name; ++name)
+    hash = hash * 31 + (uint8) *name;
+  return hash;
+}
+
+size_t DentryCache::nextGeneration()
+{
+  MutexLock lock(lock_);
+  return ++generation_;
+}
+
+bool DentryCache::lookup(Dentry* parent, const char* name, Dentry*& dentry)
+{
+  size_t name_hash = hash(parent, name);
+  MutexLock lock(lock_);
+  for (Entry* entry = buckets_[name_hash % DENTRY_CACHE_BUCKETS]; entry; entry = entry->hash_next_)
+  {
+    if (entry->hash_ != name_hash || entry->parent_ != parent || entry->generation_ != parent->getGeneration()
+        || strcmp(entry->name_.c_str(), name) != 0)
+      continue;
+    lruRemove(entry);
+    lruPushFront(entry);
+    dentry = entry->dentry_;
+    ++hits_;
+    return true;
+  }
+  ++misses_;
+  return false;
+}
+
+void DentryCache::insert(Dentry* parent, const char* name, Dentry* dentry, size_t generation)
+{
+  size_t name_hash = hash(parent, name);
+  MutexLock lock(lock_);
+  Entry* entry;
+  if (num_entries_ < DENTRY_CACHE_MAX_ENTRIES)
+  {
+    entry = new Entry;
+    ++num_entries_;
+  }
+  else
+  {
+    // entries are only references, so the least recently used one can always be reused
+    entry = lru_tail_;
+    hashRemove(entry);
+    lruRemove(entry);
+  }
+  entry->parent_ = parent;
+  entry->generation_ = generation;
+  entry->hash_ = name_hash;
+  entry->name_ = name;
+  entry->dentry_ = dentry;
+  Entry** bucket = &buckets_[name_hash % DENTRY_CACHE_BUCKETS];
+  entry->hash_next_ = *bucket;
+  *bucket = entry;
+  lruPushFront(entry);
+}
+
+void DentryCache::hashRemove(Entry* entry)
+{
+  Entry** link = &buckets_[entry->hash_ % DENTRY_CACHE_BUCKETS];
+  while (*link != entry)
+  {
+    assert(*link && "DentryCache::hashRemove: entry is not in the hash table");
+    link = &(*link)->hash_next_;
+  }
+  *link = entry->hash_next_;
+  entry->hash_next_ = 0;
+}
+
+void DentryCache::lruRemove(Entry* entry)
+{
+  if (entry->lru_prev_)
+    entry->lru_prev_->lru_next_ = entry->lru_next_;
+  else
+    lru_head_ = entry->lru_next_;
+  if (entry->lru_next_)
+    entry->lru_next_->lru_prev_ = entry->lru_prev_;
+  else
+    lru_tail_ = entry->lru_prev_;
+  entry->lru_prev_ = entry->lru_next_ = 0;
+}
+
+void DentryCache::lruPushFront(Entry* entry)
+{
+  entry->lru_prev_ = 0;
+  entry->lru_next_ = lru_head_;
+  if (lru_head_)
+    lru_head_->lru_prev_ = entry;
+  else
+    lru_tail_ = entry;
+  lru_head_ = entry;
+}
+
+void DentryCache::printStatistics()
+{
+  size_t lookups = hits_ + misses_;
+  kprintfd("DentryCache: %d names cached, %d of %d lookups hit (%d%%)\n", num_entries_, hits_, lookups,
+           lookups ? hits_ * 100 / lookups : 0);
+}
@@ -1,30 +1,127 @@
 #include "FileDescriptor.h"
-#include <ulist.h>
+#include "File.h"
+#include "Inode.h"
+#include "Superblock.h"
+#include "kstring.h"
+#include "assert.h"
 #ifndef EXE2MINIXFS
 #include "ArchThreads.h"
-#include "Mutex.h"
+#include "MutexLock.h"
+#include "Thread.h"
 #endif
 #include "kprintf.h"
 
-ustl::list<FileDescriptor*> global_fd;
-Mutex global_fd_lock("global_fd_lock");
+static FileDescriptorTable* kernel_fd_table_ = 0;
 
-static size_t fd_num_ = 3;
+FileDescriptor::FileDescriptor(File* file) :
+    fd_(-1U), file_(file), ref_count_(1)
+{
+}
+
+void FileDescriptor::addRef()
+{
+  ArchThreads::atomic_add(ref_count_, 1);
+}
+
+void FileDescriptor::release(FileDescriptor* fd)
+{
+  if (ArchThreads::atomic_add(fd->ref_count_, -1) != 1)
+    return;
+  Inode* inode = fd->getFile()->getInode();
+  assert(inode->getSuperblock()->removeFd(inode, fd) == 0);
+}
+
+int32 FileDescriptor::add(FileDescriptor* fd)
+{
+  int32 num = FileDescriptorTable::current()->add(fd);
+  fd->fd_ = num;
+  return num;
+}
+
+FileDescriptorTable::FileDescriptorTable() :
+    first_free_(FD_TABLE_FIRST), lock_("FileDescriptorTable::lock_")
+{
+  memset(entries_, 0, sizeof(entries_));
+}
+
+FileDescriptorTable::~FileDescriptorTable()
+{
+  for (size_t i = FD_TABLE_FIRST; i < FD_TABLE_SIZE; ++i)
+  {
+    if (entries_[i])
+      FileDescriptor::release(entries_[i]);
+  }
+}
+
+FileDescriptorTable* FileDescriptorTable::current()
+{
+#ifndef EXE2MINIXFS
+  if (currentThread && currentThread->fd_table_)
+    return currentThread->fd_table_;
+#endif
+  if (!kernel_fd_table_)
+    kernel_fd_table_ = new FileDescriptorTable();
+  return kernel_fd_table_;
+}
+
+int32 FileDescriptorTable::insert(FileDescriptor* fd)
+{
+  while (first_free_ < FD_TABLE_SIZE && entries_[first_free_])
+    ++first_free_;
+  if (first_free_ == FD_TABLE_SIZE)
+    return -1;
+  entries_[first_free_] = fd;
+  return first_free_++;
+}
+
+int32 FileDescriptorTable::add(FileDescriptor* fd)
+{
+  MutexLock ml(lock_);
+  return insert(fd);
+}
 
-void FileDescriptor::add(FileDescriptor* fd)
+int32 FileDescriptorTable::close(uint32 fd)
 {
-  MutexLock ml(global_fd_lock);
-  global_fd.push_back(fd);
+  FileDescriptor* file_descriptor;
+  {
+    MutexLock ml(lock_);
+    file_descriptor = get(fd);
+    if (!file_descriptor)
+      return -1;
+    entries_[fd] = 0;
+    first_free_ = Min(first_free_, fd);
+  }
+  FileDescriptor::release(file_descriptor);
+  return 0;
 }
 
-void FileDescriptor::remove(FileDescriptor* fd)
+int32 FileDescriptorTable::dup(uint32 fd)
 {
-  MutexLock ml(global_fd_lock);
-  global_fd.remove(fd);
+  MutexLock ml(lock_);
+  FileDescriptor* file_descriptor = get(fd);
+  if (!file_descriptor)
+    return -1;
+  int32 new_fd = insert(file_descriptor);
+  if (new_fd >= 0)
+    file_descriptor->addRef();
+  return new_fd;
 }
 
-FileDescriptor::FileDescriptor(File* file)
+int32 FileDescriptorTable::dup2(uint32 old_fd, uint32 new_fd)
 {
-  fd_ = ArchThreads::atomic_add(fd_num_, 1);
-  file_ = file;
+  FileDescriptor* replaced;
+  {
+    MutexLock ml(lock_);
+    FileDescriptor* file_descriptor = get(old_fd);
+    if (!file_descriptor || new_fd < FD_TABLE_FIRST || new_fd >= FD_TABLE_SIZE)
+      return -1;
+    replaced = entries_[new_fd];
+    if (replaced == file_descriptor)
+      return new_fd;
+    file_descriptor->addRef();
+    entries_[new_fd] = file_descriptor;
+  }
+  if (replaced)
+    FileDescriptor::release(replaced);
+  return new_fd;
 }
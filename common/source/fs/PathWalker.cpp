@@ -1,6 +1,7 @@
 #include "PathWalker.h"
 #include "Inode.h"
 #include "Dentry.h"
+#include "DentryCache.h"
 #include "VfsMount.h"
 #include "Superblock.h"
 #include "assert.h"
@@ -150,8 +151,15 @@ int32 PathWalker::pathWalk(const char* pathname, uint32 flags_ __attribute__ ((u
     else if (last_type_ == LAST_NORM) // follow LAST_NORM
     {
       debug(PATHWALKER, "pathWalk> follow last norm last_: %s\n", last_);
-      Inode* current_inode = dentry_->getInode();
-      Dentry *found = current_inode->lookup(last_);
+      Dentry *found;
+      if (!DentryCache::instance()->lookup(dentry_, last_, found))
+      {
+        // a child added during the lookup makes the entry stale at once
+        size_t generation = dentry_->getGeneration();
+        Inode* current_inode = dentry_->getInode();
+        found = current_inode->lookup(last_);
+        DentryCache::instance()->insert(dentry_, last_, found, generation);
+      }
       if (found)
         debug(PATHWALKER, "pathWalk> found->getName() : %s\n", found->getName());
       else
@@ -26,17 +26,7 @@ extern FileSystemInfo* default_working_dir;
 
 FileDescriptor* VfsSyscall::getFileDescriptor(uint32 fd)
 {
-  extern Mutex global_fd_lock;
-  MutexLock mlock(global_fd_lock);
-  for (auto it : global_fd)
-  {
-    if (it->getFd() == fd)
-    {
-      debug(VFSSYSCALL, "found the fd\n");
-      return it;
-    }
-  }
-  return 0;
+  return FileDescriptorTable::current()->get(fd);
 }
 
 int32 VfsSyscall::dupChecking(const char* pathname, Dentry*& pw_dentry, VfsMount*& pw_vfs_mount)
@@ -133,6 +123,7 @@ Dirent* VfsSyscall::readdir(const char* pathname)
     }
 
     debug(VFSSYSCALL, "listing dir %s:\n", pw_dentry->getName());
+    pw_dentry->getInode()->loadChildren();
     for (Dentry* sub_dentry : pw_dentry->d_child_)
     {
       uint32 inode_type = sub_dentry->getInode()->getType();
@@ -259,18 +250,24 @@ int32 VfsSyscall::rmdir(const char* pathname)
 
 int32 VfsSyscall::close(uint32 fd)
 {
-  FileDescriptor* file_descriptor = getFileDescriptor(fd);
-
-  if (file_descriptor == 0)
+  if (FileDescriptorTable::current()->close(fd) != 0)
   {
     debug(VFSSYSCALL, "(close) Error: the fd does not exist.\n");
     return -1;
   }
-  Inode* current_inode = file_descriptor->getFile()->getInode();
-  assert(current_inode->getSuperblock()->removeFd(current_inode, file_descriptor) == 0);
   return 0;
 }
 
+int32 VfsSyscall::dup(uint32 fd)
+{
+  return FileDescriptorTable::current()->dup(fd);
+}
+
+int32 VfsSyscall::dup2(uint32 old_fd, uint32 new_fd)
+{
+  return FileDescriptorTable::current()->dup2(old_fd, new_fd);
+}
+
 int32 VfsSyscall::open(const char* pathname, uint32 flag)
 {
   FileSystemInfo *fs_info = currentThread ? currentThread->getWorkingDirInfo() : default_working_dir;
@@ -113,12 +113,17 @@ int32 DeviceFSSuperBlock::createFd(Inode* inode, uint32 flag)
   File* file = inode->link(flag);
   FileDescriptor* fd = new FileDescriptor(file);
   s_files_.push_back(fd);
-  FileDescriptor::add(fd);
+  int32 num = FileDescriptor::add(fd);
+  if (num < 0)
+  {
+    FileDescriptor::release(fd);
+    return -1;
+  }
 
   if (ustl::find(used_inodes_, inode) == used_inodes_.end())
   {
     used_inodes_.push_back(inode);
   }
 
-  return (fd->getFd());
+  return num;
 }
@@ -1,9 +1,10 @@
 #include "MinixFSFile.h"
 #include "MinixFSInode.h"
 #include "Inode.h"
+#include "minix_fs_consts.h"
 
 MinixFSFile::MinixFSFile(Inode* inode, Dentry* dentry, uint32 flag) :
-    File(inode, dentry, flag)
+    File(inode, dentry, flag), ra_next_zone_(0), ra_end_zone_(0), ra_window_(0)
 {
   f_superblock_ = inode->getSuperblock();
   // to get the real mode implement it in the inode constructor and get it from there
@@ -20,6 +21,7 @@ int32 MinixFSFile::read(char *buffer, size_t count, l_off_t offset)
 {
   if (((flag_ == O_RDONLY) || (flag_ == O_RDWR)) && (mode_ & A_READABLE))
   {
+    readAhead(offset_ + offset, count);
     int32 read_bytes = f_inode_->readData(offset_ + offset, count, buffer);
     offset_ += read_bytes;
     return read_bytes;
@@ -52,3 +54,23 @@ int32 MinixFSFile::flush()
   return 0;
 }
 
+
+void MinixFSFile::readAhead(uint32 position, size_t count)
+{
+  uint32 first_zone = position / ZONE_SIZE;
+  uint32 end_zone = (position + count + ZONE_SIZE - 1) / ZONE_SIZE;
+  if (first_zone == ra_next_zone_)
+    ra_window_ = ra_window_ ? Min(2 * ra_window_, READ_AHEAD_MAX_ZONES) : READ_AHEAD_MIN_ZONES;
+  else
+  {
+    ra_window_ = 0;
+    ra_end_zone_ = 0;
+  }
+  ra_next_zone_ = (position + count) / ZONE_SIZE;
+  if (!ra_window_ || ra_end_zone_ >= end_zone + ra_window_)
+    return;
+  // the zones of this read are read by the reader, the ones behind it in the background
+  uint32 start_zone = Max(end_zone, ra_end_zone_);
+  ra_end_zone_ = end_zone + ra_window_;
+  ((MinixFSInode *) f_inode_)->readAhead(start_zone, ra_end_zone_ - start_zone);
+}
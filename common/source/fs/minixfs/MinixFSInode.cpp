@@ -1,6 +1,7 @@
 #include "MinixFSInode.h"
 #ifndef EXE2MINIXFS
 #include "kstring.h"
+#include "PageCache.h"
 #endif
 #include <assert.h>
 #include "MinixFSSuperblock.h"
@@ -8,7 +9,8 @@
 #include "Dentry.h"
 
 MinixFSInode::MinixFSInode(Superblock *super_block, uint32 inode_type) :
-    Inode(super_block, inode_type), i_zones_(0), i_num_(0), children_loaded_(false)
+    Inode(super_block, inode_type), i_zones_(0), i_num_(0), children_loaded_(false),
+    prealloc_zone_(0), prealloc_count_(0), hash_next_(0)
 {
   debug(M_INODE, "Simple Constructor\n");
   i_size_ = 0;
@@ -19,7 +21,7 @@ MinixFSInode::MinixFSInode(Superblock *super_block, uint32 inode_type) :
 MinixFSInode::MinixFSInode(Superblock *super_block, uint16 i_mode, uint32 i_size, uint16 i_nlinks, uint32* i_zones,
                            uint32 i_num) :
     Inode(super_block, 0), i_zones_(new MinixFSZone((MinixFSSuperblock*) super_block, i_zones)), i_num_(i_num),
-    children_loaded_(false)
+    children_loaded_(false), prealloc_zone_(0), prealloc_count_(0), hash_next_(0)
 {
   i_size_ = i_size;
   i_nlink_ = i_nlinks;
@@ -47,6 +49,9 @@ MinixFSInode::MinixFSInode(Superblock *super_block, uint16 i_mode, uint32 i_size
 MinixFSInode::~MinixFSInode()
 {
   debug(M_INODE, "Destructor\n");
+#ifndef EXE2MINIXFS
+  PageCache::instance()->invalidateInode(this);
+#endif
   delete i_zones_;
 
   while (!other_dentries_.empty())
@@ -67,89 +72,145 @@ int32 MinixFSInode::readData(uint32 offset, uint32 size, char *buffer)
     else
       size = i_size_ - offset;
   }
-  uint32 start_zone = offset / ZONE_SIZE;
+  MinixFSSuperblock* sb = (MinixFSSuperblock *) superblock_;
+  uint32 zone = offset / ZONE_SIZE;
   uint32 zone_offset = offset % ZONE_SIZE;
-  uint32 num_zones = (zone_offset + size) / ZONE_SIZE + 1;
   char rbuffer[ZONE_SIZE];
 
-  uint32 index = 0;
-  debug(M_INODE, "readData: zone: %d, zone_offset %d, num_zones: %d\n", start_zone, zone_offset, num_zones);
-  for (uint32 zone = start_zone; zone < start_zone + num_zones; zone++)
+  debug(M_INODE, "readData: zone: %d, zone_offset %d\n", zone, zone_offset);
+  for (uint32 index = 0; index < size; zone_offset = 0)
   {
-    memset(rbuffer, 0, sizeof(rbuffer));
-    ((MinixFSSuperblock *) superblock_)->readZone(i_zones_->getZone(zone), rbuffer);
-    uint32 count = size - index;
-    uint32 zone_diff = ZONE_SIZE - zone_offset;
-    count = count < zone_diff ? count : zone_diff;
-    memcpy(buffer + index, rbuffer + zone_offset, count);
-    index += count;
-    zone_offset = 0;
+    uint32 count = Min(size - index, ZONE_SIZE - zone_offset);
+    uint32 first_zone = i_zones_->getZone(zone);
+    if (count < ZONE_SIZE)
+    {
+      // partial zone, read it whole and copy the part we need
+      if (first_zone)
+        sb->readZone(first_zone, rbuffer);
+      else
+        memset(rbuffer, 0, sizeof(rbuffer));
+      memcpy(buffer + index, rbuffer + zone_offset, count);
+      index += count;
+      ++zone;
+      continue;
+    }
+    // full zones are read directly into the buffer, a run of consecutive zones at once
+    uint32 num_zones = 1;
+    while (first_zone && index + (num_zones + 1) * ZONE_SIZE <= size
+           && i_zones_->getZone(zone + num_zones) == first_zone + num_zones)
+      ++num_zones;
+    if (first_zone)
+      sb->readZones(first_zone, num_zones, buffer + index);
+    else
+      memset(buffer + index, 0, ZONE_SIZE);
+    index += num_zones * ZONE_SIZE;
+    zone += num_zones;
   }
   return size;
 }
 
-int32 MinixFSInode::writeData(uint32 offset, uint32 size, const char *buffer)
+void MinixFSInode::readAhead(uint32 start_zone, uint32 num_zones)
 {
-  debug(M_INODE, "MinixFSInode writeData> offset: %d, size: %d, i_size_: %d\n", offset, size, i_size_);
-  uint32 zone = offset / ZONE_SIZE;
-  uint32 num_zones = (offset % ZONE_SIZE + size) / ZONE_SIZE + 1;
-  uint32 last_used_zone = i_size_ / ZONE_SIZE;
-  uint32 last_zone = last_used_zone;
-  if ((size + offset) > i_size_)
+  uint32 end_zone = Min(start_zone + num_zones, (i_size_ + ZONE_SIZE - 1) / ZONE_SIZE);
+  end_zone = Min(end_zone, i_zones_->getNumZones());
+  size_t blocks[READ_AHEAD_MAX_ZONES];
+  uint32 num_blocks = 0;
+  for (uint32 zone = start_zone; zone < end_zone; zone++)
   {
-    uint32 num_new_zones = (size + offset - i_size_) / ZONE_SIZE + 1;
-    for (uint32 new_zones = 0; new_zones < num_new_zones; new_zones++, last_zone++)
+    // zone 0 is a hole, there is nothing to read
+    if (i_zones_->getZone(zone))
+      blocks[num_blocks++] = i_zones_->getZone(zone);
+    if (num_blocks && (num_blocks == READ_AHEAD_MAX_ZONES || zone + 1 == end_zone))
     {
-      MinixFSSuperblock* sb = (MinixFSSuperblock*) superblock_;
-      debug(M_INODE, "writeData: allocating new Zone\n");
-      uint16 new_zone = sb->allocateZone();
-      i_zones_->setZone(i_zones_->getNumZones(), new_zone);
+      ((MinixFSSuperblock *) superblock_)->readAheadBlocks(blocks, num_blocks, false);
+      num_blocks = 0;
     }
   }
+}
+
+int32 MinixFSInode::writeData(uint32 offset, uint32 size, const char *buffer)
+{
+  debug(M_INODE, "MinixFSInode writeData> offset: %d, size: %d, i_size_: %d\n", offset, size, i_size_);
+  if (!size)
+    return 0;
+  uint32 num_zones = (offset + size + ZONE_SIZE - 1) / ZONE_SIZE;
+  while (i_zones_->getNumZones() < num_zones)
+  {
+    debug(M_INODE, "writeData: allocating new Zone\n");
+    i_zones_->setZone(i_zones_->getNumZones(), allocateDataZone(num_zones - i_zones_->getNumZones()));
+  }
   if (offset > i_size_)
   {
-    debug(M_INODE, "writeData: have to clean memory\n");
-    uint32 zone_size_offset = i_size_ % ZONE_SIZE;
-    char fill_buffer[ZONE_SIZE];
-    memset(fill_buffer, 0, sizeof(fill_buffer));
-    if (zone_size_offset)
-    {
-      readData(i_size_ - zone_size_offset, zone_size_offset, fill_buffer);
-      ((MinixFSSuperblock *) superblock_)->writeZone(last_used_zone, fill_buffer);
-    }
-    ++last_used_zone;
-    for (; last_used_zone <= offset / ZONE_SIZE; last_used_zone++)
-    {
-      memset(fill_buffer, 0, sizeof(fill_buffer));
-      ((MinixFSSuperblock *) superblock_)->writeZone(last_used_zone, fill_buffer);
-    }
-    --last_used_zone;
+    debug(M_INODE, "writeData: filling the gap from %d to %d with zeros\n", i_size_, offset);
+    writeRange(i_size_, offset - i_size_, 0);
     i_size_ = offset;
   }
-  uint32 zone_offset = offset % ZONE_SIZE;
-  char* wbuffer_array = new char[num_zones * ZONE_SIZE];
-  char* wbuffer = wbuffer_array;
-  memset((void*) wbuffer, 0, num_zones * ZONE_SIZE);
-  debug(M_INODE, "writeData: reading data at the beginning of zone: offset-zone_offset: %d,zone_offset: %d\n",
-        offset - zone_offset, zone_offset);
-  readData(offset - zone_offset, zone_offset, wbuffer);
-  for (uint32 index = 0, pos = zone_offset; index < size; pos++, index++)
+  writeRange(offset, size, buffer);
+  if (i_size_ < offset + size)
   {
-    wbuffer[pos] = buffer[index];
+    i_size_ = offset + size;
   }
-  for (uint32 zone_index = 0; zone_index < num_zones; zone_index++)
+  ((MinixFSSuperblock *) superblock_)->markInodeDirty(this);
+#ifndef EXE2MINIXFS
+  PageCache::instance()->updateFromWrite(this, offset, size, buffer);
+#endif
+  return size;
+}
+
+uint32 MinixFSInode::allocateDataZone(uint32 num_zones)
+{
+  if (!prealloc_count_)
   {
-    debug(M_INODE, "writeData: writing zone_index: %d, i_zones_->getZone(zone) : %d\n", zone_index,
-          i_zones_->getZone(zone));
-    ((MinixFSSuperblock *) superblock_)->writeZone(i_zones_->getZone(zone_index + zone), wbuffer);
-    wbuffer += ZONE_SIZE;
+    uint32 last_zone = i_zones_->getNumZones();
+    uint32 goal = last_zone ? i_zones_->getZone(last_zone - 1) + 1 : 0;
+    prealloc_zone_ = ((MinixFSSuperblock*) superblock_)->allocateZones(goal, Max(num_zones, PREALLOC_ZONES),
+                                                                       prealloc_count_);
   }
-  if (i_size_ < offset + size)
+  --prealloc_count_;
+  return prealloc_zone_++;
+}
+
+void MinixFSInode::releasePreallocation()
+{
+  for (; prealloc_count_; --prealloc_count_)
+    ((MinixFSSuperblock*) superblock_)->freeZone(prealloc_zone_++);
+}
+
+void MinixFSInode::writeRange(uint32 offset, uint32 size, const char* buffer)
+{
+  MinixFSSuperblock* sb = (MinixFSSuperblock*) superblock_;
+  uint32 zone = offset / ZONE_SIZE;
+  uint32 zone_offset = offset % ZONE_SIZE;
+  char zbuffer[ZONE_SIZE];
+  for (uint32 index = 0; index < size; zone_offset = 0)
   {
-    i_size_ = offset + size;
+    uint32 count = Min(size - index, ZONE_SIZE - zone_offset);
+    uint32 first_zone = i_zones_->getZone(zone);
+    if (count < ZONE_SIZE || !buffer)
+    {
+      // partial zones are read-modify-written, unless nothing valid is stored in them yet
+      if (count < ZONE_SIZE && zone * ZONE_SIZE < i_size_)
+        sb->readZone(first_zone, zbuffer);
+      else
+        memset(zbuffer, 0, sizeof(zbuffer));
+      if (buffer)
+        memcpy(zbuffer + zone_offset, buffer + index, count);
+      else
+        memset(zbuffer + zone_offset, 0, count);
+      sb->writeZone(first_zone, zbuffer);
+      index += count;
+      ++zone;
+      continue;
+    }
+    // full zones are written straight from the buffer, a run of consecutive zones at once
+    uint32 num_zones = 1;
+    while (index + (num_zones + 1) * ZONE_SIZE <= size && i_zones_->getZone(zone + num_zones) == first_zone + num_zones)
+      ++num_zones;
+    debug(M_INODE, "writeRange: writing %d zones from zone %d\n", num_zones, first_zone);
+    sb->writeZones(first_zone, num_zones, buffer + index);
+    index += num_zones * ZONE_SIZE;
+    zone += num_zones;
   }
-  delete[] wbuffer_array;
-  return size;
 }
 
 int32 MinixFSInode::mknod(Dentry *dentry)
@@ -291,6 +352,7 @@ int32 MinixFSInode::rmdir()
 
   //the "." and ".." dentries will be deleted in some inode-dtor
   //("." in this inodes-dtor, ".." in the parent-dentry-inodes-dtor)
+  loadChildren();
   for (Dentry* child : dentry->d_child_)
   {
     if (strcmp(child->getName(), ".") != 0 && strcmp(child->getName(), "..") != 0)
@@ -366,6 +428,8 @@ Dentry* MinixFSInode::lookup(const char* name)
   if (i_type_ == I_DIR)
   {
     dentry_update = i_dentry_->checkName(name);
+    if (dentry_update == 0 && !children_loaded_)
+      dentry_update = loadChild(name);
     if (dentry_update == 0)
     {
       // ERROR_NNE
@@ -374,10 +438,6 @@ Dentry* MinixFSInode::lookup(const char* name)
     else
     {
       debug(M_INODE, "lookup: dentry_update->getName(): %s\n", dentry_update->getName());
-      if (((MinixFSInode *) dentry_update->getInode())->i_type_ == I_DIR)
-      {
-        ((MinixFSInode *) dentry_update->getInode())->loadChildren();
-      }
       return dentry_update;
     }
   }
@@ -388,6 +448,64 @@ Dentry* MinixFSInode::lookup(const char* name)
   }
 }
 
+Dentry* MinixFSInode::loadChild(const char* name)
+{
+  if (strlen(name) > (size_t) MAX_NAME_LENGTH)
+    return 0;
+  char dbuffer[ZONE_SIZE];
+  for (uint32 zone = 0; zone < i_zones_->getNumZones(); zone++)
+  {
+    ((MinixFSSuperblock *) superblock_)->readZone(i_zones_->getZone(zone), dbuffer);
+    for (uint32 curr_dentry = 0; curr_dentry < BLOCK_SIZE; curr_dentry += INODE_SIZE)
+    {
+      uint16 inode_index = *(uint16*) (dbuffer + curr_dentry);
+      if (inode_index && strncmp(dbuffer + curr_dentry + INODE_BYTES, name, MAX_NAME_LENGTH) == 0)
+      {
+        debug(M_INODE, "loadChild: found %s in zone %d\n", name, zone);
+        return addChild(inode_index, dbuffer + curr_dentry + INODE_BYTES);
+      }
+    }
+  }
+  return 0;
+}
+
+Dentry* MinixFSInode::addChild(uint16 i_num, const char* entry_name)
+{
+  debug(M_INODE, "addChild: loading child %d\n", i_num);
+  bool is_already_loaded = false;
+
+  Inode* inode = ((MinixFSSuperblock *) superblock_)->getInode(i_num, is_already_loaded);
+
+  if (!inode)
+  {
+    kprintfd("MinixFSInode::addChild: inode nr. %d not set in bitmap, but occurs in directory-entry; "
+             "maybe filesystem was not properly unmounted last time\n",
+             i_num);
+    char ch = 0;
+    writeDentry(i_num, 0, &ch);
+    return 0;
+  }
+
+  char name[MAX_NAME_LENGTH + 1];
+  strncpy(name, entry_name, MAX_NAME_LENGTH);
+
+  name[MAX_NAME_LENGTH] = 0;
+
+  debug(M_INODE, "addChild: dentry name: %s\n", name);
+  Dentry *new_dentry = new Dentry(name);
+  i_dentry_->setChild(new_dentry);
+  new_dentry->setParent(i_dentry_);
+  if (!is_already_loaded)
+  {
+    ((MinixFSInode *) inode)->i_dentry_ = new_dentry;
+    ((MinixFSSuperblock *) superblock_)->all_inodes_add_inode(inode);
+  }
+  else
+    ((MinixFSInode *) inode)->other_dentries_.push_back(new_dentry);
+  new_dentry->setInode(inode);
+  return new_dentry;
+}
+
 void MinixFSInode::loadChildren()
 {
   if (children_loaded_)
@@ -396,47 +514,26 @@ void MinixFSInode::loadChildren()
     return;
   }
   char dbuffer[ZONE_SIZE];
+  uint16 i_nums[BLOCK_SIZE / 32];
   for (uint32 zone = 0; zone < i_zones_->getNumZones(); zone++)
   {
     ((MinixFSSuperblock *) superblock_)->readZone(i_zones_->getZone(zone), dbuffer);
+    // the inodes of the children are read together, neighbours share inode table blocks
+    uint32 num_inodes = 0;
+    for (uint32 curr_dentry = 0; curr_dentry < BLOCK_SIZE; curr_dentry += INODE_SIZE)
+      i_nums[num_inodes++] = *(uint16*) (dbuffer + curr_dentry);
+    ((MinixFSSuperblock *) superblock_)->readAheadInodes(i_nums, num_inodes);
     for (uint32 curr_dentry = 0; curr_dentry < BLOCK_SIZE; curr_dentry += INODE_SIZE)
     {
       uint16 inode_index = *(uint16*) (dbuffer + curr_dentry);
-      if (inode_index)
-      {
-        debug(M_INODE, "loadChildren: loading child %d\n", inode_index);
-        bool is_already_loaded = false;
-
-        Inode* inode = ((MinixFSSuperblock *) superblock_)->getInode(inode_index, is_already_loaded);
-
-        if (!inode)
-        {
-          kprintfd("MinixFSInode::loadChildren: inode nr. %d not set in bitmap, but occurs in directory-entry; "
-                   "maybe filesystem was not properly unmounted last time\n",
-                   inode_index);
-          char ch = 0;
-          writeDentry(inode_index, 0, &ch);
-          continue;
-        }
-
-        char name[MAX_NAME_LENGTH + 1];
-        strncpy(name, dbuffer + curr_dentry + INODE_BYTES, MAX_NAME_LENGTH);
-
-        name[MAX_NAME_LENGTH] = 0;
-
-        debug(M_INODE, "loadChildren: dentry name: %s\n", name);
-        Dentry *new_dentry = new Dentry(name);
-        i_dentry_->setChild(new_dentry);
-        new_dentry->setParent(i_dentry_);
-        if (!is_already_loaded)
-        {
-          ((MinixFSInode *) inode)->i_dentry_ = new_dentry;
-          ((MinixFSSuperblock *) superblock_)->all_inodes_add_inode(inode);
-        }
-        else
-          ((MinixFSInode *) inode)->other_dentries_.push_back(new_dentry);
-        new_dentry->setInode(inode);
-      }
+      if (!inode_index)
+        continue;
+      char name[MAX_NAME_LENGTH + 1];
+      strncpy(name, dbuffer + curr_dentry + INODE_BYTES, MAX_NAME_LENGTH);
+      name[MAX_NAME_LENGTH] = 0;
+      // children which have been looked up or created already have their dentry
+      if (!i_dentry_->checkName(name))
+        addChild(inode_index, name);
     }
   }
   children_loaded_ = true;
@@ -9,8 +9,7 @@
 #include <unistd.h>
 #else
 #include "kstring.h"
-#include "BDManager.h"
-#include "BDVirtualDevice.h"
+#include "BlockCache.h"
 #endif
 
 #define ROOT_NAME "/"
@@ -19,6 +18,7 @@ MinixFSSuperblock::MinixFSSuperblock(Dentry* s_root, size_t s_dev, uint64 offset
     Superblock(s_root, s_dev), superblock_(this)
 {
   offset_ = offset;
+  memset(inode_hash_, 0, sizeof(inode_hash_));
   //read Superblock data from disc
   readHeader();
   debug(M_SB, "s_num_inodes_ : %d\ns_zones_ : %d\ns_num_inode_bm_blocks_ : %d\ns_num_zone_bm_blocks_ : %d\n"
@@ -90,14 +90,13 @@ void MinixFSSuperblock::initInodes()
   root_dentry->setInode(root_inode);
 
   all_inodes_add_inode(root_inode);
-  //read children from disc
-  root_inode->loadChildren();
+  // the children are read from disc when they are looked up
 
 }
 
 MinixFSInode* MinixFSSuperblock::getInode(uint16 i_num, bool &is_already_loaded)
 {
-  MinixFSInode* tmp = (MinixFSInode*) all_inodes_set_[i_num];
+  MinixFSInode* tmp = lookupInode(i_num);
   if (tmp)
   {
     is_already_loaded = true;
@@ -124,17 +123,14 @@ MinixFSInode* MinixFSSuperblock::getInode(uint16 i_num)
 
     return 0;
   }
-  uint32 inodes_start = s_num_inode_bm_blocks_ + s_num_zone_bm_blocks_ + 2;
-  uint32 inode_block_num = inodes_start + (i_num - 1) / INODES_PER_BLOCK;
+  uint32 inode_block_num = getInodeBlock(i_num);
   MinixFSInode *inode = 0;
-  char ibuffer_array[BLOCK_SIZE];
-  char* ibuffer = ibuffer_array;
-  debug(M_SB, "getInode::reading block num: %d\n", inode_block_num);
-  readBlocks(inode_block_num, 1, ibuffer);
-  debug(M_SB, "getInode:: returned reading block num: %d\n", inode_block_num);
+  uint32 ibuffer_array[64 / sizeof(uint32)];
+  char* ibuffer = (char*) ibuffer_array;
   uint32 offset = ((i_num - 1) % INODES_PER_BLOCK) * INODE_SIZE;
-  debug(M_SB, "getInode:: setting offset: %d\n", offset);
-  ibuffer += offset;
+  debug(M_SB, "getInode::reading block num: %d, offset: %d\n", inode_block_num, offset);
+  // only the inode itself is copied, the block stays in the block cache for its neighbours
+  readBytes(inode_block_num, offset, INODE_SIZE, ibuffer);
   uint32 i_zones[NUM_ZONES];
   for (uint32 num_zone = 0; num_zone < NUM_ZONES; num_zone++)
   {
@@ -150,6 +146,7 @@ MinixFSInode* MinixFSSuperblock::getInode(uint16 i_num)
 MinixFSSuperblock::~MinixFSSuperblock()
 {
   debug(M_SB, "~MinixSuperblock\n");
+  writeDirtyInodes();
   assert(dirty_inodes_.empty() == true);
   storage_manager_->flush(this);
   for (FileDescriptor* fd : s_files_)
@@ -180,7 +177,10 @@ MinixFSSuperblock::~MinixFSSuperblock()
   delete storage_manager_;
 
   all_inodes_.clear();
-  all_inodes_set_.clear();
+  memset(inode_hash_, 0, sizeof(inode_hash_));
+#ifndef EXE2MINIXFS
+  BlockCache::instance()->invalidate(s_dev_);
+#endif
 
   debug(M_SB, "~MinixSuperblock finished\n");
 }
@@ -224,9 +224,8 @@ int32 MinixFSSuperblock::readInode(Inode* inode)
 {
   assert(inode);
   MinixFSInode *minix_inode = (MinixFSInode *) inode;
-  assert(ustl::find(all_inodes_.begin(), all_inodes_.end(), inode) != all_inodes_.end());
-  uint32 block = 2 + s_num_inode_bm_blocks_ + s_num_zone_bm_blocks_
-      + ((minix_inode->i_num_ - 1) * INODE_SIZE / BLOCK_SIZE);
+  assert(lookupInode(minix_inode->i_num_) == minix_inode);
+  uint32 block = getInodeBlock(minix_inode->i_num_);
   uint32 offset = ((minix_inode->i_num_ - 1) * INODE_SIZE) % BLOCK_SIZE;
   char buffer[INODE_SIZE];
   readBytes(block, offset, INODE_SIZE, buffer);
@@ -250,11 +249,10 @@ int32 MinixFSSuperblock::readInode(Inode* inode)
 void MinixFSSuperblock::writeInode(Inode* inode)
 {
   assert(inode);
-  assert(ustl::find(all_inodes_.begin(), all_inodes_.end(), inode) != all_inodes_.end());
   //flush zones
   MinixFSInode *minix_inode = (MinixFSInode *) inode;
-  uint32 block = 2 + s_num_inode_bm_blocks_ + s_num_zone_bm_blocks_
-      + ((minix_inode->i_num_ - 1) * INODE_SIZE / BLOCK_SIZE);
+  assert(lookupInode(minix_inode->i_num_) == minix_inode);
+  uint32 block = getInodeBlock(minix_inode->i_num_);
   uint32 offset = ((minix_inode->i_num_ - 1) * INODE_SIZE) % BLOCK_SIZE;
   char buffer[INODE_SIZE];
   memset((void*) buffer, 0, sizeof(buffer));
@@ -290,14 +288,81 @@ void MinixFSSuperblock::writeInode(Inode* inode)
 
 void MinixFSSuperblock::all_inodes_add_inode(Inode* inode)
 {
+  MinixFSInode* minix_inode = (MinixFSInode*) inode;
+  assert(!lookupInode(minix_inode->i_num_));
   all_inodes_.push_back(inode);
-  all_inodes_set_[((MinixFSInode*) inode)->i_num_] = inode;
+  MinixFSInode** bucket = &inode_hash_[minix_inode->i_num_ % INODE_HASH_BUCKETS];
+  minix_inode->hash_next_ = *bucket;
+  *bucket = minix_inode;
 }
 
 void MinixFSSuperblock::all_inodes_remove_inode(Inode* inode)
 {
+  MinixFSInode* minix_inode = (MinixFSInode*) inode;
   all_inodes_.remove(inode);
-  all_inodes_set_.erase(((MinixFSInode*) inode)->i_num_);
+  MinixFSInode** link = &inode_hash_[minix_inode->i_num_ % INODE_HASH_BUCKETS];
+  while (*link != minix_inode)
+  {
+    assert(*link && "MinixFSSuperblock::all_inodes_remove_inode: inode is not in the hash table");
+    link = &(*link)->hash_next_;
+  }
+  *link = minix_inode->hash_next_;
+  minix_inode->hash_next_ = 0;
+}
+
+MinixFSInode* MinixFSSuperblock::lookupInode(uint32 i_num)
+{
+  MinixFSInode* inode = inode_hash_[i_num % INODE_HASH_BUCKETS];
+  while (inode && inode->i_num_ != i_num)
+    inode = inode->hash_next_;
+  return inode;
+}
+
+uint32 MinixFSSuperblock::getInodeBlock(uint32 i_num)
+{
+  return 2 + s_num_inode_bm_blocks_ + s_num_zone_bm_blocks_ + (i_num - 1) / INODES_PER_BLOCK;
+}
+
+void MinixFSSuperblock::readAheadInodes(const uint16* i_nums, uint32 num_inodes)
+{
+  size_t blocks[READ_AHEAD_MAX_ZONES];
+  uint32 num_blocks = 0;
+  for (uint32 i = 0; i < num_inodes; ++i)
+  {
+    if (!i_nums[i] || i_nums[i] > s_num_inodes_ || lookupInode(i_nums[i]))
+      continue;
+    size_t block = getInodeBlock(i_nums[i]);
+    bool listed = false;
+    for (uint32 j = 0; j < num_blocks && !listed; ++j)
+      listed = blocks[j] == block;
+    if (!listed)
+      blocks[num_blocks++] = block;
+    if (num_blocks == READ_AHEAD_MAX_ZONES)
+    {
+      readAheadBlocks(blocks, num_blocks);
+      num_blocks = 0;
+    }
+  }
+  if (num_blocks)
+    readAheadBlocks(blocks, num_blocks);
+}
+
+void MinixFSSuperblock::markInodeDirty(MinixFSInode* inode)
+{
+  if (inode->i_state_ == I_DIRTY)
+    return;
+  inode->i_state_ = I_DIRTY;
+  dirty_inodes_.push_back(inode);
+}
+
+void MinixFSSuperblock::writeDirtyInodes()
+{
+  for (Inode* inode : dirty_inodes_)
+  {
+    writeInode(inode);
+    ((MinixFSInode*) inode)->i_state_ = I_UNUSED;
+  }
+  dirty_inodes_.clear();
 }
 
 void MinixFSSuperblock::delete_inode(Inode* inode)
@@ -309,6 +374,7 @@ void MinixFSSuperblock::delete_inode(Inode* inode)
   MinixFSInode *minix_inode = (MinixFSInode *) inode;
   all_inodes_remove_inode(minix_inode);
   assert(minix_inode->i_files_.empty());
+  minix_inode->releasePreallocation();
   minix_inode->i_zones_->freeZones();
   storage_manager_->freeInode(minix_inode->i_num_);
   uint32 block = 2 + s_num_inode_bm_blocks_ + s_num_zone_bm_blocks_
@@ -327,14 +393,19 @@ int32 MinixFSSuperblock::createFd(Inode* inode, uint32 flag)
   File* file = inode->link(flag);
   FileDescriptor* fd = new FileDescriptor(file);
   s_files_.push_back(fd);
-  FileDescriptor::add(fd);
+  int32 num = FileDescriptor::add(fd);
+  if (num < 0)
+  {
+    FileDescriptor::release(fd);
+    return -1;
+  }
 
   if (ustl::find(used_inodes_.begin(), used_inodes_.end(), inode) == used_inodes_.end())
   {
     used_inodes_.push_back(inode);
   }
 
-  return (fd->getFd());
+  return num;
 }
 
 int32 MinixFSSuperblock::removeFd(Inode* inode, FileDescriptor* fd)
@@ -343,7 +414,6 @@ int32 MinixFSSuperblock::removeFd(Inode* inode, FileDescriptor* fd)
   assert(fd);
 
   s_files_.remove(fd);
-  FileDescriptor::remove(fd);
 
   File* file = fd->getFile();
   int32 tmp = inode->unlink(file);
@@ -352,8 +422,14 @@ int32 MinixFSSuperblock::removeFd(Inode* inode, FileDescriptor* fd)
   if (inode->getNumOpenedFile() == 0)
   {
     used_inodes_.remove(inode);
+    ((MinixFSInode*) inode)->releasePreallocation();
   }
   delete fd;
+  writeDirtyInodes();
+#ifndef EXE2MINIXFS
+  // closing a file writes the modified blocks back
+  BlockCache::instance()->flush(s_dev_);
+#endif
 
   return tmp;
 }
@@ -366,10 +442,26 @@ uint16 MinixFSSuperblock::allocateZone()
   return ret;
 }
 
+uint16 MinixFSSuperblock::allocateZones(uint16 goal, uint32 max_zones, uint32& num_zones)
+{
+  size_t goal_index = goal >= s_1st_datazone_ ? goal - s_1st_datazone_ + 1 : 0;
+  size_t allocated;
+  uint16 ret = storage_manager_->allocZones(goal_index, max_zones, allocated) + s_1st_datazone_ - 1;
+  num_zones = allocated;
+  debug(M_SB, "MinixFSSuperblock allocateZones> goal %d, returning %d zones from %d\n", goal, num_zones, ret);
+  return ret;
+}
+
 void MinixFSSuperblock::readZone(uint16 zone, char* buffer)
 {
   assert(buffer);
-  readBlocks(zone, ZONE_SIZE / BLOCK_SIZE, buffer);
+  readZones(zone, 1, buffer);
+}
+
+void MinixFSSuperblock::readZones(uint16 zone, uint32 num_zones, char* buffer)
+{
+  assert(buffer);
+  readBlocks(zone, num_zones * (ZONE_SIZE / BLOCK_SIZE), buffer);
 }
 
 void MinixFSSuperblock::readBlocks(uint16 block, uint32 num_blocks, char* buffer)
@@ -379,43 +471,82 @@ void MinixFSSuperblock::readBlocks(uint16 block, uint32 num_blocks, char* buffer
   fseek((FILE*)s_dev_, offset_ + block * BLOCK_SIZE, SEEK_SET);
   assert(fread(buffer, 1, BLOCK_SIZE * num_blocks, (FILE*)s_dev_) == BLOCK_SIZE * num_blocks);
 #else
-  BDVirtualDevice* bdvd = BDManager::getInstance()->getDeviceByNumber(s_dev_);
-  bdvd->readData(block * bdvd->getBlockSize(), num_blocks * bdvd->getBlockSize(), buffer);
+  BlockCache::instance()->readBlocks(s_dev_, block, num_blocks, buffer);
+#endif
+}
+
+void MinixFSSuperblock::readAheadBlocks(const size_t* blocks, uint32 num_blocks, bool wait)
+{
+#ifdef EXE2MINIXFS
+  // there is no block cache in the host tool
+  (void) blocks;
+  (void) num_blocks;
+  (void) wait;
+#else
+  if (wait)
+    BlockCache::instance()->prefetchBlocks(s_dev_, blocks, num_blocks);
+  else
+    BlockCache::instance()->readAhead(s_dev_, blocks, num_blocks);
 #endif
 }
 
-void MinixFSSuperblock::writeZone(uint16 zone, char* buffer)
+void MinixFSSuperblock::writeZone(uint16 zone, const char* buffer)
 {
-  writeBlocks(zone, ZONE_SIZE / BLOCK_SIZE, buffer);
+  writeZones(zone, 1, buffer);
 }
 
-void MinixFSSuperblock::writeBlocks(uint16 block, uint32 num_blocks, char* buffer)
+void MinixFSSuperblock::writeZones(uint16 zone, uint32 num_zones, const char* buffer)
+{
+  writeBlocks(zone, num_zones * (ZONE_SIZE / BLOCK_SIZE), buffer);
+}
+
+void MinixFSSuperblock::writeBlocks(uint16 block, uint32 num_blocks, const char* buffer)
 {
 #ifdef EXE2MINIXFS
   fseek((FILE*)s_dev_, offset_ + block * BLOCK_SIZE, SEEK_SET);
   assert(fwrite(buffer, 1, BLOCK_SIZE * num_blocks, (FILE*)s_dev_) == BLOCK_SIZE * num_blocks);
 #else
-  BDVirtualDevice* bdvd = BDManager::getInstance()->getDeviceByNumber(s_dev_);
-  bdvd->writeData(block * bdvd->getBlockSize(), num_blocks * bdvd->getBlockSize(), buffer);
+  BlockCache* cache = BlockCache::instance();
+  for (uint32 i = 0; i < num_blocks; ++i)
+  {
+    BlockBuffer* block_buffer = cache->getBlock(s_dev_, block + i, false);
+    assert(block_buffer->getBlockSize() == BLOCK_SIZE);
+    memcpy(block_buffer->getData(), buffer + i * BLOCK_SIZE, BLOCK_SIZE);
+    block_buffer->markDirty();
+    cache->releaseBlock(block_buffer);
+  }
 #endif
 }
 
 int32 MinixFSSuperblock::readBytes(uint32 block, uint32 offset, uint32 size, char* buffer)
 {
   assert(offset+size <= BLOCK_SIZE);
+#ifdef EXE2MINIXFS
   char rbuffer[BLOCK_SIZE];
   readBlocks(block, 1, rbuffer);
-  memcpy(rbuffer + offset, buffer, size);
+  memcpy(buffer, rbuffer + offset, size);
+#else
+  BlockBuffer* block_buffer = BlockCache::instance()->getBlock(s_dev_, block);
+  memcpy(buffer, block_buffer->getData() + offset, size);
+  BlockCache::instance()->releaseBlock(block_buffer);
+#endif
   return size;
 }
 
 int32 MinixFSSuperblock::writeBytes(uint32 block, uint32 offset, uint32 size, char* buffer)
 {
   assert(offset+size <= BLOCK_SIZE);
+#ifdef EXE2MINIXFS
   char wbuffer[BLOCK_SIZE];
   readBlocks(block, 1, wbuffer);
   memcpy(wbuffer + offset, buffer, size);
   writeBlocks(block, 1, wbuffer);
+#else
+  BlockBuffer* block_buffer = BlockCache::instance()->getBlock(s_dev_, block);
+  memcpy(block_buffer->getData() + offset, buffer, size);
+  block_buffer->markDirty();
+  BlockCache::instance()->releaseBlock(block_buffer);
+#endif
   return size;
 }
 
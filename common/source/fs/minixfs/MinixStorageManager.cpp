@@ -78,6 +78,45 @@ size_t MinixStorageManager::allocZone()
   return 0;
 }
 
+size_t MinixStorageManager::allocZones(size_t goal, size_t max_zones, size_t& num_zones)
+{
+  assert(max_zones > 0);
+  size_t size = zone_bitmap_.getSize();
+  if (!goal || goal >= size)
+    goal = curr_zone_pos_ + 1;
+  size_t first = 0;
+  num_zones = 0;
+  for (size_t pos = goal; pos < size;)
+  {
+    if (zone_bitmap_.getBit(pos))
+    {
+      ++pos;
+      continue;
+    }
+    size_t length = 1;
+    while (length < max_zones && pos + length < size && !zone_bitmap_.getBit(pos + length))
+      ++length;
+    if (!first || pos == goal || length == max_zones)
+    {
+      first = pos;
+      num_zones = length;
+    }
+    if (pos == goal || length == max_zones)
+      break;
+    pos += length;
+  }
+  if (!first)
+  {
+    num_zones = 1;
+    return allocZone();
+  }
+  for (size_t pos = first; pos < first + num_zones; ++pos)
+    zone_bitmap_.setBit(pos);
+  curr_zone_pos_ = first + num_zones - 1;
+  debug(M_STORAGE_MANAGER, "allocZones: Zones %zu to %zu acquired for goal %zu\n", first, curr_zone_pos_, goal);
+  return first;
+}
+
 size_t MinixStorageManager::allocInode()
 {
   size_t pos = curr_inode_pos_ + 1;
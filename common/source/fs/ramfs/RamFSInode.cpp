@@ -6,6 +6,7 @@
 #include "fs/Dentry.h"
 
 #include "console/kprintf.h"
+#include "mm/PageCache.h"
 
 #define BASIC_ALLOC 256
 
@@ -22,6 +23,7 @@ RamFSInode::RamFSInode(Superblock *super_block, uint32 inode_type) :
 
 RamFSInode::~RamFSInode()
 {
+  PageCache::instance()->invalidateInode(this);
   delete[] data_;
 }
 
@@ -50,6 +52,7 @@ int32 RamFSInode::writeData(uint32 offset, uint32 size, const char *buffer)
 
   char *ptr_offset = data_ + offset;
   memcpy(ptr_offset, buffer, size);
+  PageCache::instance()->updateFromWrite(this, offset, size, buffer);
   return size;
 }
 
@@ -112,14 +112,19 @@ int32 RamFSSuperblock::createFd(Inode* inode, uint32 flag)
   File* file = inode->link(flag);
   FileDescriptor* fd = new FileDescriptor(file);
   s_files_.push_back(fd);
-  FileDescriptor::add(fd);
+  int32 num = FileDescriptor::add(fd);
+  if (num < 0)
+  {
+    FileDescriptor::release(fd);
+    return -1;
+  }
 
   if (ustl::find(used_inodes_, inode) == used_inodes_.end())
   {
     used_inodes_.push_back(inode);
   }
 
-  return (fd->getFd());
+  return num;
 }
 
 int32 RamFSSuperblock::removeFd(Inode* inode, FileDescriptor* fd)
@@ -128,7 +133,6 @@ int32 RamFSSuperblock::removeFd(Inode* inode, FileDescriptor* fd)
   assert(fd);
 
   s_files_.remove(fd);
-  FileDescriptor::remove(fd);
 
   File* file = fd->getFile();
   int32 tmp = inode->unlink(file);
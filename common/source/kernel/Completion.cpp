@@ -0,0 +1,68 @@
+#include "Completion.h"
+#include "Thread.h"
+#include "Scheduler.h"
+#include "ArchInterrupts.h"
+#include "assert.h"
+
+Completion::Completion() :
+  done_(0), waiter_(0)
+{
+}
+
+bool Completion::wait(size_t timeout_ticks)
+{
+  if (done_)
+    return true;
+
+  bool interrupts_enabled = ArchInterrupts::disableInterrupts();
+  if (unlikely(system_state != RUNNING || !currentThread))
+  {
+    // nobody to put to sleep, the interrupt handler completes us meanwhile
+    ArchInterrupts::enableInterrupts();
+    for (size_t jiffies = 0; !done_ && jiffies < IO_TIMEOUT; ++jiffies)
+      ArchInterrupts::yieldIfIFSet();
+    if (!interrupts_enabled)
+      ArchInterrupts::disableInterrupts();
+    return done_;
+  }
+
+  assert(!waiter_ && "Completion::wait: there is a waiting thread already");
+  Scheduler* scheduler = Scheduler::instance();
+  size_t wakeup_tick = timeout_ticks ? Max(scheduler->getTicks() + timeout_ticks, 1) : 0;
+  // interrupts are disabled from checking done_ until the thread is marked as sleeping,
+  // so a complete() in between cannot get lost
+  while (!done_ && (!wakeup_tick || scheduler->getTicks() < wakeup_tick))
+  {
+    waiter_ = currentThread;
+    currentThread->wakeup_tick_ = wakeup_tick;
+    currentThread->state_ = Sleeping;
+    ArchInterrupts::enableInterrupts();
+    scheduler->yield();
+    ArchInterrupts::disableInterrupts();
+  }
+  waiter_ = 0;
+  currentThread->wakeup_tick_ = 0;
+  bool done = done_;
+  if (interrupts_enabled)
+    ArchInterrupts::enableInterrupts();
+  return done;
+}
+
+void Completion::complete()
+{
+  bool interrupts_enabled = ArchInterrupts::disableInterrupts();
+  done_ = 1;
+  Thread* waiter = waiter_;
+  if (waiter)
+  {
+    waiter_ = 0;
+    Scheduler::instance()->wake(waiter);
+  }
+  if (interrupts_enabled)
+    ArchInterrupts::enableInterrupts();
+}
+
+bool Completion::isDone()
+{
+  return done_;
+}
@@ -41,10 +41,10 @@ void Condition::wait(const char* debug_info, bool re_acquire_mutex)
   }
 }
 
-void Condition::signal(const char* debug_info)
+Thread* Condition::signal(const char* debug_info)
 {
   if(unlikely(system_state != RUNNING))
-    return;
+    return 0;
   assert(mutex_->isHeldBy(currentThread));
   checkInterrupts("Condition::signal", debug_info);
   lockWaitersList();
@@ -72,6 +72,7 @@ void Condition::signal(const char* debug_info)
       assert(false);
     }
   }
+  return thread_to_be_woken_up;
 }
 
 void Condition::broadcast(const char* debug_info)
@@ -17,41 +17,100 @@
 #include <umemory.h>
 #include "File.h"
 #include "FileDescriptor.h"
+#include "Inode.h"
+#include "PageCache.h"
+#include "SwapManager.h"
 
-Loader::Loader ( ssize_t fd, Thread *thread ) : fd_ ( fd ),
-    thread_ ( thread ), hdr_(0), phdrs_(), load_lock_("Loader::load_lock_"),
-    userspace_debug_info_(0)
+Loader::Loader ( FileDescriptor* file_descriptor, Thread *thread ) : file_descriptor_ ( file_descriptor ),
+    thread_ ( thread ), hdr_(0), phdrs_(), inode_(0), load_lock_("Loader::load_lock_"),
+    heap_start_(0), heap_break_(0), userspace_debug_info_(0)
 {
+  if (file_descriptor_)
+    file_descriptor_->addRef();
 }
 
 Loader::~Loader()
 {
+  {
+    MutexLock loadlock(load_lock_);
+    // only the populated parts of the address space are visited
+    unmapRange(0, USER_STACK_END / PAGE_SIZE);
+  }
+  if (SwapManager::instance())
+    SwapManager::instance()->removeAddressSpace(this);
   delete userspace_debug_info_;
   delete hdr_;
+  if (file_descriptor_)
+    FileDescriptor::release(file_descriptor_);
 }
 
 
-void Loader::initUserspaceAddressSpace()
+pointer Loader::initUserspaceAddressSpace()
 {
-  size_t page_for_stack = PageManager::instance()->allocPPN();
+  pointer stack_top = allocateStack(LOADER_STACK_LIMIT);
+  if (stack_top)
+  {
+    MutexLock loadlock(load_lock_);
+    mapZeroPage(stack_top / PAGE_SIZE - 1);
+  }
+  return stack_top;
+}
+
+pointer Loader::allocateStack(size_t limit)
+{
+  size_t num_pages = (limit + PAGE_SIZE - 1) / PAGE_SIZE;
+  if (num_pages == 0)
+    return 0;
+
+  MutexLock loadlock(load_lock_);
+  VirtualMemoryArea stack;
+  stack.start_page = vmas_.findFreeRange(num_pages, MMAP_AREA_END / PAGE_SIZE, USER_STACK_END / PAGE_SIZE,
+                                         LOADER_STACK_GUARD_PAGES);
+  if (!stack.start_page)
+  {
+    debug(LOADER, "allocateStack: no space left for a stack of %d pages\n", num_pages);
+    return 0;
+  }
+  stack.end_page = stack.start_page + num_pages;
+  stack.kind = VMA_STACK;
+  stack.prot = PROT_READ | PROT_WRITE;
+  stack.flags = MAP_ANONYMOUS;
+  stack.file = 0;
+  stack.file_page = 0;
+  vmas_.insert(stack);
+  debug(LOADER, "allocateStack: stack from %x to %x\n", stack.start_page * PAGE_SIZE, stack.end_page * PAGE_SIZE);
+  return stack.end_page * PAGE_SIZE;
+}
 
-  arch_memory_.mapPage(1024*512-1, page_for_stack, 1); // (1024 * 512 - 1) * 4 KiB is exactly 2GiB - 4KiB
+void Loader::releaseStack(pointer stack_top)
+{
+  MutexLock loadlock(load_lock_);
+  VirtualMemoryArea* stack = vmas_.find(stack_top / PAGE_SIZE - 1);
+  assert(stack && stack->kind == VMA_STACK && stack->end_page * PAGE_SIZE == stack_top &&
+         "releaseStack: not a stack of this address space");
+  unmapRange(stack->start_page, stack->end_page);
 }
 
 
+ssize_t Loader::readFile(char* buffer, l_off_t position, size_t count)
+{
+  if (!file_descriptor_)
+    return -1;
+  File* file = file_descriptor_->getFile();
+  file->lseek(position, SEEK_SET);
+  return file->read(buffer, count, 0);
+}
+
 bool Loader::readFromBinary (char* buffer, l_off_t position, size_t count)
 {
-  VfsSyscall::lseek(fd_, position, SEEK_SET);
-  return VfsSyscall::read(fd_, buffer, count) - (int32)count;
+  return readFile(buffer, position, count) - (int32)count;
 }
 
 bool Loader::readHeaders()
 {
   hdr_ = new Elf::Ehdr;
 
-  VfsSyscall::lseek(fd_, 0, SEEK_SET);
-  if(!hdr_ || VfsSyscall::read(fd_, reinterpret_cast<char*>(hdr_),
-              sizeof(Elf::Ehdr)) != sizeof(Elf::Ehdr))
+  if(!hdr_ || readFile(reinterpret_cast<char*>(hdr_), 0, sizeof(Elf::Ehdr)) != sizeof(Elf::Ehdr))
   {
     return false;
   }
@@ -73,6 +132,63 @@ bool Loader::readHeaders()
     return false;
   }
 
+  // index of the loadable segments sorted by their start address
+  for (Elf::Phdr& phdr : phdrs_)
+  {
+    debug(LOADER, "readHeaders: .vaddr=%x .type=%x .flags=%x .memsz=%x .filesz=%x .offset=%x\n", phdr.p_vaddr,
+          phdr.p_type, phdr.p_flags, phdr.p_memsz, phdr.p_filesz, phdr.p_offset);
+    if (phdr.p_type != Elf::PT_LOAD || phdr.p_memsz == 0)
+      continue;
+    if (phdr.p_filesz > phdr.p_memsz)
+      return false;
+    LoadSegment segment;
+    segment.start = phdr.p_vaddr;
+    segment.file_end = phdr.p_vaddr + phdr.p_filesz;
+    segment.mem_end = phdr.p_vaddr + phdr.p_memsz;
+    segment.file_offset = phdr.p_offset;
+    segment.writeable = phdr.p_flags & Elf::PF_W;
+    size_t index = segments_.size();
+    for (; index > 0 && segments_[index - 1].start > segment.start; --index);
+    segments_.insert(segments_.begin() + index, segment);
+  }
+  for (size_t i = 1; i < segments_.size(); ++i)
+  {
+    if (segments_[i].start < segments_[i - 1].mem_end)
+    {
+      debug(LOADER, "readHeaders: segments at %x and %x overlap\n", segments_[i - 1].start, segments_[i].start);
+      return false;
+    }
+  }
+
+  if (file_descriptor_)
+    inode_ = file_descriptor_->getFile()->getInode();
+
+  // one memory area for each run of segments sharing pages
+  MutexLock loadlock(load_lock_);
+  for (size_t i = 0; i < segments_.size();)
+  {
+    VirtualMemoryArea area;
+    area.start_page = segments_[i].start / PAGE_SIZE;
+    area.end_page = area.start_page;
+    area.kind = VMA_ELF;
+    area.prot = PROT_READ;
+    area.flags = 0;
+    area.file = 0;
+    area.file_page = 0;
+    for (; i < segments_.size() && segments_[i].start / PAGE_SIZE < Max(area.end_page, area.start_page + 1); ++i)
+    {
+      area.end_page = (segments_[i].mem_end + PAGE_SIZE - 1) / PAGE_SIZE;
+      if (segments_[i].writeable)
+        area.prot |= PROT_WRITE;
+    }
+    if (area.end_page > USER_STACK_END / PAGE_SIZE || !vmas_.isFree(area.start_page, area.end_page))
+    {
+      debug(LOADER, "readHeaders: segments at %x collide with the stack or the kernel\n", area.start_page * PAGE_SIZE);
+      return false;
+    }
+    vmas_.insert(area);
+  }
+
   return true;
 }
 
@@ -80,11 +196,31 @@ bool Loader::loadExecutableAndInitProcess()
 {
   debug ( LOADER,"Loader::loadExecutableAndInitProcess: going to load an executable\n" );
 
-  initUserspaceAddressSpace();
+  pointer stack_top = initUserspaceAddressSpace();
+  if (!stack_top)
+    return false;
 
   if(!readHeaders())
     return false;
 
+  if (!segments_.empty())
+    heap_start_ = (segments_.back().mem_end + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+
+  if (LOADER_EAGER_LOAD)
+  {
+    MutexLock loadlock(load_lock_);
+    for (LoadSegment& segment : segments_)
+    {
+      size_t end_page = (segment.mem_end + PAGE_SIZE - 1) / PAGE_SIZE;
+      for (size_t page = segment.start / PAGE_SIZE; page < end_page; page += LOADER_FAULT_AROUND_PAGES)
+      {
+        if (!loadExecutablePages(page, Min(page + LOADER_FAULT_AROUND_PAGES, end_page)))
+          return false;
+      }
+    }
+  }
+  heap_break_ = heap_start_;
+
   debug ( LOADER,"loadExecutableAndInitProcess: Entry: %x, num Sections %x\n",hdr_->e_entry, hdr_->e_phnum );
   if (LOADER & OUTPUT_ENABLED)
     Elf::printElfHeader ( *hdr_ );
@@ -95,7 +231,7 @@ bool Loader::loadExecutableAndInitProcess()
   ArchThreads::createThreadInfosUserspaceThread (
         thread_->user_arch_thread_info_,
         hdr_->e_entry,
-        2U*1024U*1024U*1024U - sizeof ( pointer ),
+        stack_top - sizeof ( pointer ),
         thread_->getStackStartPointer()
   );
 
@@ -104,166 +240,456 @@ bool Loader::loadExecutableAndInitProcess()
   return true;
 }
 
-struct PagePart
+Loader::LoadSegment* Loader::findSegment(pointer address)
 {
-  size_t page_byte;
-  size_t vaddr;
-  size_t length;
-};
+  // first segment ending above the address
+  size_t low = 0;
+  size_t high = segments_.size();
+  while (low < high)
+  {
+    size_t middle = (low + high) / 2;
+    if (segments_[middle].mem_end <= address)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low < segments_.size() ? &segments_[low] : 0;
+}
 
-void Loader::loadOnePageSafeButSlow ( pointer virtual_address )
+void Loader::loadExecutablePage(pointer virtual_address)
 {
+  assert(load_lock_.isHeldBy(currentThread));
   size_t virtual_page = virtual_address / PAGE_SIZE;
+  debug ( LOADER,"loadExecutablePage: going to load virtual page %d (virtual_address=%d) for %d:%s\n",virtual_page,virtual_address,currentThread->getTID(),currentThread->getName() );
 
-  MutexLock loadlock(load_lock_);
-  //check if page has not been loaded meanwhile
-  if(arch_memory_.checkAddressValid(virtual_address))
+  pointer page_start = virtual_page * PAGE_SIZE;
+  LoadSegment* segment = findSegment(page_start);
+  if (!segment || segment->start >= page_start + PAGE_SIZE)
   {
-    debug ( LOADER,"loadOnePageSafeButSlow: Page %d (virtual_address=%d) has already been mapped, probably by another thread between pagefault and reaching loader.\n",virtual_page,virtual_address );
-    return;
+    kprintfd ( "Loader::loadExecutablePage: ERROR Request for Unknown Memory Location: v_adddr=%x, v_page=%d\n",virtual_address,virtual_page);
+    load_lock_.release();
+    //free unmapped page
+    Syscall::exit ( 9997 );
   }
 
-  debug ( LOADER,"loadOnePageSafeButSlow: going to load virtual page %d (virtual_address=%d) for %d:%s\n",virtual_page,virtual_address,currentThread->getTID(),currentThread->getName() );
+  // fault around: load the neighbouring pages of the segment with the same read
+  size_t window_start = virtual_page - virtual_page % LOADER_FAULT_AROUND_PAGES;
+  size_t first_page = Max(window_start, segment->start / PAGE_SIZE);
+  size_t end_page = Min(window_start + LOADER_FAULT_AROUND_PAGES, (segment->mem_end + PAGE_SIZE - 1) / PAGE_SIZE);
+  if (!loadExecutablePages(first_page, end_page))
+  {
+    kprintfd ( "Loader::loadExecutablePage: ERROR part of executable not present in file: v_adddr=%x, v_page=%d\n", virtual_address, virtual_page);
+    load_lock_.release();
+    Syscall::exit ( 9998 );
+  }
+}
 
-  debug ( LOADER,"loadOnePage: Num ents: %d\n",hdr_->e_phnum );
-  debug ( LOADER,"loadOnePage: Entry: %x\n",hdr_->e_entry );
+bool Loader::isExecutablePage(size_t virtual_page)
+{
+  LoadSegment* segment = findSegment(virtual_page * PAGE_SIZE);
+  return segment && segment->start < (virtual_page + 1) * PAGE_SIZE && !arch_memory_.getMappedPPN(virtual_page) &&
+         !arch_memory_.getSwapSlot(virtual_page);
+}
 
-  size_t page = 0;
-  size_t i=0;
-  size_t k=0;
-  size_t written=0;
+bool Loader::isSharedTextPage(size_t virtual_page, size_t& file_page)
+{
+  pointer page_start = virtual_page * PAGE_SIZE;
+  LoadSegment* segment = findSegment(page_start);
+  // the file page must not contain bytes behind the segment (e.g. the start of .data),
+  // they have to read as zero in the text segment, so partial pages are copied
+  if (!inode_ || !segment || segment->writeable || segment->start > page_start ||
+      segment->file_end < page_start + PAGE_SIZE || (segment->start - segment->file_offset) % PAGE_SIZE)
+    return false;
+  file_page = (segment->file_offset + (page_start - segment->start)) / PAGE_SIZE;
+  return true;
+}
 
-  ustl::vector<PagePart> byte_map;
-  PagePart part;
-  size_t min_value = 0xFFFFFFFF;
-  size_t max_value = 0;
-  if (virtual_address != 0)
+bool Loader::loadExecutablePages(size_t first_page, size_t end_page)
+{
+  assert(load_lock_.isHeldBy(currentThread));
+  for (size_t virtual_page = first_page; virtual_page < end_page; ++virtual_page)
   {
-    for ( i=0; i < PAGE_SIZE; ++i )
+    size_t file_page;
+    if (!isExecutablePage(virtual_page) || !isSharedTextPage(virtual_page, file_page))
+      continue;
+    size_t page = PageCache::instance()->getPage(inode_, file_page);
+    arch_memory_.mapPage(virtual_page, page, true);
+    arch_memory_.setPageWriteable(virtual_page, 0);
+  }
+  for (; first_page < end_page && !isExecutablePage(first_page); ++first_page);
+  for (; end_page > first_page && !isExecutablePage(end_page - 1); --end_page);
+  if (first_page == end_page)
+    return true;
+
+  assert(end_page - first_page <= LOADER_FAULT_AROUND_PAGES);
+  pointer range_start = first_page * PAGE_SIZE;
+  pointer range_end = end_page * PAGE_SIZE;
+  char* buffer = new char[range_end - range_start];
+  memset(buffer, 0, range_end - range_start);
+
+  // segments are page aligned in the usual case, so this reads one extent,
+  // everything not read (bss) stays zero
+  for (LoadSegment* segment = findSegment(range_start); segment != segments_.end() && segment->start < range_end;
+       ++segment)
+  {
+    pointer from = Max(segment->start, range_start);
+    pointer to = Min(segment->file_end, range_end);
+    if (from >= to)
+      continue;
+
+    debug(LOADER, "loadExecutablePages: reading %d bytes from file offset %x to %x\n", to - from,
+          segment->file_offset + (from - segment->start), from);
+    if (readFile(buffer + (from - range_start), segment->file_offset + (from - segment->start), to - from) !=
+        static_cast<ssize_t>(to - from))
     {
-      size_t load_byte_from_address = virtual_page*PAGE_SIZE + i;
-      size_t found = 0;
-      for ( k=0;k < hdr_->e_phnum; ++k )
-      {
-        Elf::Phdr& h = phdrs_[k];
+      delete[] buffer;
+      return false;
+    }
+  }
 
-        debug ( LOADER,"loadOnePage: PHdr[%d].vaddr=%x .paddr=%x .type=%x .flags=%x .memsz=%x .filez=%x .poff=%x\r\n",k,h.p_vaddr,h.p_paddr,h.p_type,h.p_flags,h.p_memsz,h.p_filesz,h.p_offset );
+  // map every run of private pages with a single page table walk
+  size_t pages[LOADER_FAULT_AROUND_PAGES];
+  size_t num_pages = 0;
+  for (size_t virtual_page = first_page; virtual_page <= end_page; ++virtual_page)
+  {
+    if (virtual_page < end_page && isExecutablePage(virtual_page))
+    {
+      pages[num_pages] = PageManager::instance()->allocPPN();
+      memcpy((void*) ArchMemory::getIdentAddressOfPPN(pages[num_pages]),
+             buffer + (virtual_page - first_page) * PAGE_SIZE, PAGE_SIZE);
+      ++num_pages;
+      continue;
+    }
+    if (!num_pages)
+      continue;
+    size_t run_start = virtual_page - num_pages;
+    size_t mapped = arch_memory_.mapRange(run_start, num_pages, pages, true);
+    assert(mapped == num_pages);
+    for (size_t i = 0; i < num_pages; ++i)
+      makeSwappable(run_start + i, pages[i]);
+    num_pages = 0;
+  }
+  debug(LOADER, "loadExecutablePages: loaded pages %x to %x\n", first_page, end_page - 1);
+  delete[] buffer;
+  return true;
+}
 
-        if (ADDRESS_BETWEEN(load_byte_from_address, h.p_paddr, h.p_paddr + h.p_filesz))
-        {
-          size_t byte_to_load = h.p_offset + load_byte_from_address - h.p_paddr;
+bool Loader::handlePageFault(pointer address, bool present, bool writing)
+{
+  size_t virtual_page = address / PAGE_SIZE;
+  MutexLock loadlock(load_lock_);
+  if (!present)
+  {
+    //check if page has not been loaded meanwhile
+    if (arch_memory_.checkAddressValid(address))
+    {
+      debug(LOADER, "handlePageFault: page %x has already been mapped, probably by another thread\n", virtual_page);
+      return true;
+    }
+    if (swapInPage(virtual_page))
+      return true;
+  }
 
-          if(byte_to_load < min_value)
-            min_value = byte_to_load;
+  VirtualMemoryArea* area = vmas_.find(virtual_page);
+  if (!area)
+  {
+    debug(LOADER, "handlePageFault: no memory area at %x\n", address);
+    return false;
+  }
 
-          size_t load_count = (h.p_paddr + h.p_filesz) - load_byte_from_address;
-          if (load_count + i > PAGE_SIZE)
-              load_count = PAGE_SIZE - i;
-          part.page_byte = i;
-          part.vaddr = byte_to_load;
-          part.length = load_count;
-          i += load_count - 1;
+  switch (area->kind)
+  {
+    case VMA_MMAP:
+      return loadMappedPage(*area, virtual_page, present, writing);
+    case VMA_ELF:
+      if (present)
+        return false;
+      loadExecutablePage(address);
+      return true;
+    default: // heap and stacks
+      if (present)
+        return false;
+      mapZeroPage(virtual_page);
+      return true;
+  }
+}
 
-          if(byte_to_load + load_count > max_value)
-            max_value = byte_to_load + load_count;
+void Loader::makeSwappable(size_t virtual_page, size_t ppn)
+{
+  if (SwapManager::instance())
+    SwapManager::instance()->addPage(ppn, this, virtual_page);
+}
 
-          //its VERY MUCH more efficient to only search the bytes, save them in the array byte_map,
-          //and read ONCE from the executable; its very expensive to read every byte single from harddisk
-          //(we have to read a full zone) -> for this we also need the max- and min-byte from file we have to load
+void Loader::mapZeroPage(size_t virtual_page)
+{
+  assert(load_lock_.isHeldBy(currentThread));
+  size_t page = PageManager::instance()->allocPPN();
+  memset((void*) ArchMemory::getIdentAddressOfPPN(page), 0, PAGE_SIZE);
+  arch_memory_.mapPage(virtual_page, page, 1);
+  makeSwappable(virtual_page, page);
+}
 
-          byte_map.push_back(part);
+bool Loader::swapInPage(size_t virtual_page)
+{
+  assert(load_lock_.isHeldBy(currentThread));
+  size_t swap_slot = arch_memory_.getSwapSlot(virtual_page);
+  if (!swap_slot)
+    return false;
 
-          ++written;
-          ++found;
-        }
-        // bss is not in the file but in memory
-        else if (ADDRESS_BETWEEN(load_byte_from_address, h.p_paddr, h.p_paddr + h.p_memsz))
-        {
-          // skip ahead to end of section
-          i += (h.p_paddr + h.p_memsz) - load_byte_from_address - 1;
-          debug ( LOADER,"In segment but not on file, this is .bss\n" );
-          ++found;
-          ++written;
-        }
-      }
+  size_t page = PageManager::instance()->allocPPN();
+  if (!SwapManager::instance()->swapIn(swap_slot, page))
+  {
+    kprintfd("Loader::swapInPage: ERROR reading page %x from swap slot %d failed\n", virtual_page, swap_slot);
+    PageManager::instance()->freePPN(page);
+    arch_memory_.clearSwapSlot(virtual_page);
+    load_lock_.release();
+    Syscall::exit(9996);
+  }
+  arch_memory_.mapPage(virtual_page, page, 1);
+  VirtualMemoryArea* area = vmas_.find(virtual_page);
+  if (area && !(area->prot & PROT_WRITE))
+    arch_memory_.setPageWriteable(virtual_page, 0);
+  makeSwappable(virtual_page, page);
+  debug(LOADER, "swapInPage: swapped in page %x from slot %d\n", virtual_page, swap_slot);
+  return true;
+}
 
-      if ( !found )
-      {
-        debug ( LOADER,"Byte not found, byte virtual address is %x\n",load_byte_from_address );
-        // this is expected behaviour. Our Loader tries to find every bytes on a needed page in the ELF Header.
-        // Of course, often only parts of a page are listed in the ELF Hedaer
-      }
-      else if ( found >1 )
-      {
-        kprintfd ( "Loader::loadOnePageSafeButSlow:EEEEEEEEEEEERRRRRRRROR, found the byte (%x) in two different segments\n", load_byte_from_address );
-      }
+bool Loader::loadMappedPage(VirtualMemoryArea& mapping, size_t virtual_page, bool present, bool writing)
+{
+  assert(load_lock_.isHeldBy(currentThread));
+  if (!(mapping.prot & (PROT_READ | PROT_WRITE)) || (writing && !(mapping.prot & PROT_WRITE)))
+  {
+    debug(LOADER, "loadMappedPage: access to page %x violates the protection of its mapping\n", virtual_page);
+    return false;
+  }
+
+  size_t mapped_ppn = arch_memory_.getMappedPPN(virtual_page);
+  if (present || mapped_ppn)
+  {
+    // the page might have been mapped by another thread in the meantime
+    if (!writing || !mapped_ppn || (mapping.flags & MAP_SHARED))
+      return true;
+
+    // copy on write of a private page
+    if (PageManager::instance()->getRefCount(mapped_ppn) == 1)
+    {
+      arch_memory_.setPageWriteable(virtual_page, 1);
+      return true;
     }
+    size_t page = PageManager::instance()->allocPPN();
+    memcpy((void*) ArchMemory::getIdentAddressOfPPN(page), (void*) ArchMemory::getIdentAddressOfPPN(mapped_ppn), PAGE_SIZE);
+    arch_memory_.unmapPage(virtual_page);
+    arch_memory_.mapPage(virtual_page, page, 1);
+    makeSwappable(virtual_page, page);
+    debug(LOADER, "loadMappedPage: copied private page %x on write\n", virtual_page);
+    return true;
   }
 
-  if ( !written )
+  if (!mapping.file)
   {
-    kprintfd ( "Loader::loadOnePageSafeButSlow: ERROR Request for Unknown Memory Location: v_adddr=%x, v_page=%d\n",virtual_address,virtual_page);
-    load_lock_.release();
-    //free unmapped page
-    Syscall::exit ( 9997 );
+    mapZeroPage(virtual_page);
+    if (!(mapping.prot & PROT_WRITE))
+      arch_memory_.setPageWriteable(virtual_page, 0);
+    return true;
   }
 
-  //in this case all bytes are in bss-section, but not in file
-  if(max_value == 0 && min_value == 0xffffffff)
+  size_t file_page = mapping.file_page + virtual_page - mapping.start_page;
+  size_t page = PageCache::instance()->getPage(mapping.file->getInode(), file_page);
+  if (!(mapping.flags & MAP_SHARED) && writing)
   {
-    debug(LOADER, "%x is in .bss\n", virtual_address);
-    page = PageManager::instance()->allocPPN();
-    memset((void*)ArchMemory::getIdentAddressOfPPN(page), 0, PAGE_SIZE);
-    arch_memory_.mapPage(virtual_page, page, true);
+    size_t copy = PageManager::instance()->allocPPN();
+    memcpy((void*) ArchMemory::getIdentAddressOfPPN(copy), (void*) ArchMemory::getIdentAddressOfPPN(page), PAGE_SIZE);
+    PageManager::instance()->freePPN(page);
+    arch_memory_.mapPage(virtual_page, copy, 1);
+    makeSwappable(virtual_page, copy);
+    return true;
+  }
+
+  // private pages are mapped read-only until they are written to
+  arch_memory_.mapPage(virtual_page, page, 1);
+  if (!(mapping.flags & MAP_SHARED) || !(mapping.prot & PROT_WRITE))
+    arch_memory_.setPageWriteable(virtual_page, 0);
+  return true;
+}
+
+pointer Loader::mmap(size_t length, size_t prot, size_t flags, size_t fd, size_t offset)
+{
+  if (length == 0 || offset % PAGE_SIZE || (prot & ~(PROT_READ | PROT_WRITE)) ||
+      (flags & ~(MAP_SHARED | MAP_ANONYMOUS)))
+    return 0;
+
+  size_t num_pages = (length + PAGE_SIZE - 1) / PAGE_SIZE;
+  File* file = 0;
+  if (!(flags & MAP_ANONYMOUS))
+  {
+    FileDescriptor* file_descriptor = VfsSyscall::getFileDescriptor(fd);
+    if (!file_descriptor)
+      return 0;
+    File* opened = file_descriptor->getFile();
+    uint32 access = opened->getFlag() & (O_WRONLY | O_RDWR);
+    if (access == O_WRONLY || ((flags & MAP_SHARED) && (prot & PROT_WRITE) && access != O_RDWR))
+      return 0;
+    // hold an own reference to the inode, the mapping survives closing the file descriptor
+    file = opened->getInode()->link(opened->getFlag());
+    if (!file)
+      return 0;
+  }
+
+  MutexLock loadlock(load_lock_);
+  VirtualMemoryArea mapping;
+  mapping.start_page = vmas_.findFreeRange(num_pages, MMAP_AREA_START / PAGE_SIZE, MMAP_AREA_END / PAGE_SIZE, 0);
+  if (!mapping.start_page)
+  {
+    debug(LOADER, "mmap: no space left for %d pages\n", num_pages);
+    if (file)
+      file->getInode()->unlink(file);
+    return 0;
+  }
+
+  mapping.end_page = mapping.start_page + num_pages;
+  mapping.kind = VMA_MMAP;
+  mapping.prot = prot;
+  mapping.flags = flags;
+  mapping.file = file;
+  mapping.file_page = offset / PAGE_SIZE;
+  vmas_.insert(mapping);
+  debug(LOADER, "mmap: mapped %d pages at %x\n", num_pages, mapping.start_page * PAGE_SIZE);
+  return mapping.start_page * PAGE_SIZE;
+}
+
+void Loader::syncMapping(VirtualMemoryArea& mapping, size_t first_page, size_t end_page)
+{
+  if (!mapping.file || !(mapping.flags & MAP_SHARED))
+    return;
+  Inode* inode = mapping.file->getInode();
+  first_page = Max(first_page, mapping.start_page);
+  end_page = Min(end_page, mapping.end_page);
+  if (first_page >= end_page)
     return;
+  for (size_t page = first_page; page < end_page; ++page)
+  {
+    if (arch_memory_.testAndClearDirty(page))
+      PageCache::instance()->markDirty(inode, mapping.file_page + page - mapping.start_page);
   }
+  PageCache::instance()->writeBack(inode, mapping.file_page + first_page - mapping.start_page, end_page - first_page);
+}
+
+void Loader::unmapRange(size_t first_page, size_t end_page)
+{
+  assert(load_lock_.isHeldBy(currentThread));
+  for (size_t i = vmas_.lowerBound(first_page); i < vmas_.size() && vmas_[i].start_page < end_page;)
+  {
+    VirtualMemoryArea area = vmas_[i];
+    size_t from = Max(first_page, area.start_page);
+    size_t to = Min(end_page, area.end_page);
 
-  //read once the bytes we need (and a few more, probably, depends on elf-format)
-  size_t buffersize = max_value - min_value;
-  uint8 buffer[PAGE_SIZE];
-  assert(buffersize <= PAGE_SIZE && "this should never occur");
+    syncMapping(area, from, to);
+    unmapPages(from, to);
 
-  VfsSyscall::lseek(fd_, min_value, SEEK_SET);
-  ssize_t bytes_read = VfsSyscall::read(fd_, (char*)buffer, max_value - min_value);
+    vmas_.erase(i);
+    if (from > area.start_page)
+    {
+      VirtualMemoryArea below = area;
+      below.end_page = from;
+      vmas_.insert(below);
+      ++i;
+    }
+    else if (area.file)
+    {
+      area.file->getInode()->unlink(area.file);
+    }
+    if (to < area.end_page)
+    {
+      VirtualMemoryArea above = area;
+      above.start_page = to;
+      above.file_page += to - area.start_page;
+      if (above.file)
+        above.file = above.file->getInode()->link(above.file->getFlag());
+      vmas_.insert(above);
+      ++i;
+    }
+  }
+}
 
-  if(bytes_read != static_cast<ssize_t>(max_value - min_value))
+void Loader::unmapPages(size_t first_page, size_t end_page)
+{
+  assert(load_lock_.isHeldBy(currentThread));
+  if (SwapManager::instance())
   {
-    if (bytes_read == -1)
+    for (size_t page = first_page; page < end_page; ++page)
     {
-      if (VfsSyscall::getFileDescriptor(fd_) == 0)
+      size_t swap_slot = arch_memory_.getSwapSlot(page);
+      if (swap_slot)
       {
-        kprintfd("Loader::loadOnePageSafeButSlow: ERROR cannot read from a closed file descriptor\n");
-        assert(false);
+        SwapManager::instance()->freeSlot(swap_slot);
+        arch_memory_.clearSwapSlot(page);
       }
     }
-    kprintfd ( "Loader::loadOnePageSafeButSlow: ERROR part of executable not present in file: v_adddr=%x, v_page=%d\n", virtual_address, virtual_page);
-    load_lock_.release();
-    Syscall::exit ( 9998 );
-   }
-  page = PageManager::instance()->allocPPN();
-  debug(PM, "got new page %x\n", page);
-  memset((void*)ArchMemory::getIdentAddressOfPPN(page), 0, PAGE_SIZE);
-  debug(PM, "bzero!\n");
-  uint8* dest = reinterpret_cast<uint8*> (ArchMemory::getIdentAddressOfPPN ( page ));
-  debug(PM, "copying %d elements\n", byte_map.size());
-  written = 0;
-  for(i=0; i < byte_map.size(); i++)
-  {
-    part = byte_map[i];
-
-    debug(PM, "copying %dth element from %x to %x ;   page byte: %d, length: %d\n", i, buffer+part.vaddr - min_value, dest + part.page_byte, part.page_byte, part.length);
-
-    assert(part.vaddr - min_value + part.length <= buffersize);
-    assert(part.page_byte + part.length <= PAGE_SIZE);
-    memcpy(dest + part.page_byte, buffer + part.vaddr - min_value, part.length);
-    written += part.length;
   }
+  arch_memory_.unmapRange(first_page, end_page - first_page);
+}
 
-  arch_memory_.mapPage(virtual_page, page, true);
-  debug ( PM,"loadOnePageSafeButSlow: wrote a total of %d bytes\n",written );
+int32 Loader::munmap(pointer start, size_t length)
+{
+  if (start % PAGE_SIZE || length == 0)
+    return -1;
+  MutexLock loadlock(load_lock_);
+  unmapRange(start / PAGE_SIZE, (start + length + PAGE_SIZE - 1) / PAGE_SIZE);
+  return 0;
+}
 
+int32 Loader::msync(pointer start, size_t length)
+{
+  if (start % PAGE_SIZE)
+    return -1;
+  size_t first_page = start / PAGE_SIZE;
+  size_t end_page = (start + length + PAGE_SIZE - 1) / PAGE_SIZE;
+  MutexLock loadlock(load_lock_);
+  for (size_t i = vmas_.lowerBound(first_page); i < vmas_.size() && vmas_[i].start_page < end_page; ++i)
+    syncMapping(vmas_[i], first_page, end_page);
+  return 0;
 }
 
+pointer Loader::brk(pointer end)
+{
+  MutexLock loadlock(load_lock_);
+  // the heap must not grow into the memory mappings
+  if (end < heap_start_ || end > MMAP_AREA_START)
+    return heap_break_;
+
+  size_t end_page = (end + PAGE_SIZE - 1) / PAGE_SIZE;
+  size_t old_end_page = (heap_break_ + PAGE_SIZE - 1) / PAGE_SIZE;
+  if (end_page > old_end_page)
+  {
+    if (!vmas_.isFree(old_end_page, end_page))
+      return heap_break_;
+    VirtualMemoryArea* heap = old_end_page > heap_start_ / PAGE_SIZE ? vmas_.find(old_end_page - 1) : 0;
+    if (heap)
+    {
+      assert(heap->kind == VMA_HEAP);
+      heap->end_page = end_page;
+    }
+    else
+    {
+      VirtualMemoryArea area;
+      area.start_page = heap_start_ / PAGE_SIZE;
+      area.end_page = end_page;
+      area.kind = VMA_HEAP;
+      area.prot = PROT_READ | PROT_WRITE;
+      area.flags = MAP_ANONYMOUS;
+      area.file = 0;
+      area.file_page = 0;
+      vmas_.insert(area);
+    }
+  }
+  else if (end_page < old_end_page)
+  {
+    unmapRange(end_page, old_end_page);
+  }
+  debug(LOADER, "brk: moved the end of the heap from %x to %x\n", heap_break_, end);
+  heap_break_ = end;
+  return heap_break_;
+}
 
 bool Loader::loadDebugInfoIfAvailable()
 {
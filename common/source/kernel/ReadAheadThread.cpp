@@ -0,0 +1,20 @@
+#include "ReadAheadThread.h"
+#include "BlockCache.h"
+
+ReadAheadThread::ReadAheadThread() : Thread(0, "ReadAheadThread")
+{
+  state_ = Worker;
+}
+
+void ReadAheadThread::Run()
+{
+  while (1)
+  {
+    while (hasWork())
+    {
+      BlockCache::instance()->runReadAhead();
+      jobDone();
+    }
+    waitForNextJob();
+  }
+}
@@ -13,6 +13,7 @@
 #include "umap.h"
 #include "ustring.h"
 #include "Lock.h"
+#include "ThreadCache.h"
 
 ArchThreadInfo *currentThreadInfo;
 Thread *currentThread;
@@ -30,6 +31,7 @@ Scheduler::Scheduler()
 {
   block_scheduling_ = 0;
   ticks_ = 0;
+  handoff_thread_ = 0;
   addNewThread(&cleanup_thread_);
   addNewThread(&idle_thread_);
 }
@@ -43,17 +45,29 @@ uint32 Scheduler::schedule()
   }
 
   Thread* previousThread = currentThread;
-  do
+  Thread* handoff_thread = handoff_thread_;
+  handoff_thread_ = 0;
+  if (handoff_thread && handoff_thread->schedulable())
+    currentThread = handoff_thread;
+  else
   {
-    currentThread = threads_.front();
+    do
+    {
+      currentThread = threads_.front();
+      if (currentThread->state_ == Sleeping && currentThread->wakeup_tick_ && ticks_ >= currentThread->wakeup_tick_)
+      {
+        currentThread->wakeup_tick_ = 0;
+        wake(currentThread);
+      }
 
-    ustl::rotate(threads_.begin(), threads_.begin() + 1, threads_.end()); // no new/delete here - important because interrupts are disabled
+      ustl::rotate(threads_.begin(), threads_.begin() + 1, threads_.end()); // no new/delete here - important because interrupts are disabled
 
-    if ((currentThread == previousThread) && (currentThread->state_ != Running))
-    {
-      debug(SCHEDULER, "Scheduler::schedule: ERROR: currentThread == previousThread! Either no thread is in state Running or you added the same thread more than once.");
-    }
-  } while (!currentThread->schedulable());
+      if ((currentThread == previousThread) && (currentThread->state_ != Running))
+      {
+        debug(SCHEDULER, "Scheduler::schedule: ERROR: currentThread == previousThread! Either no thread is in state Running or you added the same thread more than once.");
+      }
+    } while (!currentThread->schedulable());
+  }
 //  debug ( SCHEDULER,"Scheduler::schedule: new currentThread is %x %s, switch_userspace:%d\n",currentThread,currentThread ? currentThread->getName() : 0,currentThread ? currentThread->switch_to_userspace_ : 0);
 
   uint32 ret = 1;
@@ -109,6 +123,22 @@ void Scheduler::yield()
   ArchThreads::yield();
 }
 
+void Scheduler::yieldTo(Thread* thread)
+{
+  // the thread might have died since it has been woken up, only hand over to threads still in the list
+  lockScheduling();
+  for (ThreadList::iterator it = threads_.begin(); it != threads_.end(); ++it)
+  {
+    if (*it == thread)
+    {
+      handoff_thread_ = thread;
+      break;
+    }
+  }
+  unlockScheduling();
+  yield();
+}
+
 void Scheduler::cleanupDeadThreads()
 {
   lockScheduling();
@@ -124,6 +154,8 @@ void Scheduler::cleanupDeadThreads()
     {
       destroy_list[thread_count++] = tmp;
       threads_.erase(threads_.begin() + i); // Note: erase will not realloc!
+      if (handoff_thread_ == tmp)
+        handoff_thread_ = 0;
       --i;
     }
     if (thread_count >= thread_count_max)
@@ -150,6 +182,7 @@ void Scheduler::printThreadList()
     debug(SCHEDULER, "Scheduler::printThreadList: threads_[%d]: %x  %d:%s     [%s]\n", c, threads_[c],
           threads_[c]->getTID(), threads_[c]->getName(), Thread::threadStatePrintable[threads_[c]->state_]);
   unlockScheduling();
+  ThreadCache::instance()->printStatistics();
 }
 
 void Scheduler::lockScheduling() //not as severe as stopping Interrupts
@@ -0,0 +1,20 @@
+#include "SwapThread.h"
+#include "SwapManager.h"
+
+SwapThread::SwapThread() : Thread(0, "SwapThread")
+{
+  state_ = Worker;
+}
+
+void SwapThread::Run()
+{
+  while (1)
+  {
+    while (hasWork())
+    {
+      SwapManager::instance()->reclaim();
+      jobDone();
+    }
+    waitForNextJob();
+  }
+}
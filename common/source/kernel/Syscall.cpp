@@ -11,6 +11,7 @@
 #include "UserProcess.h"
 #include "ProcessRegistry.h"
 #include "File.h"
+#include "Loader.h"
 
 size_t Syscall::syscallException(size_t syscall_number, size_t arg1, size_t arg2, size_t arg3, size_t arg4, size_t arg5)
 {
@@ -43,12 +44,30 @@ size_t Syscall::syscallException(size_t syscall_number, size_t arg1, size_t arg2
     case sc_close:
       return_value = close(arg1);
       break;
+    case sc_dup:
+      return_value = dup(arg1);
+      break;
+    case sc_dup2:
+      return_value = dup2(arg1, arg2);
+      break;
     case sc_outline:
       outline(arg1, arg2);
       break;
     case sc_trace:
       trace();
       break;
+    case sc_mmap:
+      return_value = mmap(arg1);
+      break;
+    case sc_munmap:
+      return_value = munmap(arg1, arg2);
+      break;
+    case sc_msync:
+      return_value = msync(arg1, arg2, arg3);
+      break;
+    case sc_brk:
+      return_value = brk(arg1);
+      break;
     case sc_pseudols:
       VfsSyscall::readdir((const char*) arg1);
       break;
@@ -108,6 +127,16 @@ size_t Syscall::close(size_t fd)
   return VfsSyscall::close(fd);
 }
 
+size_t Syscall::dup(size_t fd)
+{
+  return VfsSyscall::dup(fd);
+}
+
+size_t Syscall::dup2(size_t old_fd, size_t new_fd)
+{
+  return VfsSyscall::dup2(old_fd, new_fd);
+}
+
 size_t Syscall::open(size_t path, size_t flags)
 {
   if (path >= 2U * 1024U * 1024U * 1024U)
@@ -117,6 +146,51 @@ size_t Syscall::open(size_t path, size_t flags)
   return VfsSyscall::open((char*) path, flags);
 }
 
+size_t Syscall::mmap(size_t args)
+{
+  if (args >= 2U * 1024U * 1024U * 1024U || args + 6 * sizeof(size_t) > 2U * 1024U * 1024U * 1024U ||
+      !currentThread->loader_)
+  {
+    return (size_t) -1;
+  }
+  size_t* mmap_args = (size_t*) args;
+  size_t length = mmap_args[1];
+  size_t prot = mmap_args[2];
+  size_t flags = mmap_args[3];
+  size_t fd = mmap_args[4];
+  size_t offset = mmap_args[5];
+  // the start address is only a hint, it is ignored
+  pointer start = currentThread->loader_->mmap(length, prot, flags, fd, offset);
+  return start ? start : (size_t) -1;
+}
+
+size_t Syscall::munmap(size_t start, size_t length)
+{
+  if (start >= 2U * 1024U * 1024U * 1024U || !currentThread->loader_)
+  {
+    return (size_t) -1;
+  }
+  return currentThread->loader_->munmap(start, length);
+}
+
+size_t Syscall::msync(size_t start, size_t length, size_t flags)
+{
+  if (start >= 2U * 1024U * 1024U * 1024U || !currentThread->loader_ || (flags & ~(MS_SYNC | MS_ASYNC)))
+  {
+    return (size_t) -1;
+  }
+  return currentThread->loader_->msync(start, length);
+}
+
+size_t Syscall::brk(size_t end)
+{
+  if (!currentThread->loader_)
+  {
+    return (size_t) -1;
+  }
+  return currentThread->loader_->brk(end);
+}
+
 void Syscall::outline(size_t port, pointer text)
 {
   //WARNING: this might fail if Kernel PageFaults are not handled
@@ -5,10 +5,13 @@
 #include "ArchInterrupts.h"
 #include "Scheduler.h"
 #include "Loader.h"
+#include "FileDescriptor.h"
 #include "Console.h"
 #include "Terminal.h"
 #include "backtrace.h"
 #include "KernelMemoryManager.h"
+#include "KernelStackManager.h"
+#include "ThreadCache.h"
 #include "Stabs2DebugInfo.h"
 
 #define MAX_STACK_FRAMES 20
@@ -28,12 +31,13 @@ static void ThreadStartHack()
 }
 
 Thread::Thread(FileSystemInfo *working_dir, const char *name) :
-    kernel_arch_thread_info_(0), user_arch_thread_info_(0), switch_to_userspace_(0), loader_(0), state_(Running),
-    next_thread_in_lock_waiters_list_(0), lock_waiting_on_(0), holding_lock_list_(0), tid_(0),
+    kernel_arch_thread_info_(0), user_arch_thread_info_(0),
+    stack_((uint32*) KernelStackManager::instance()->allocStack()), switch_to_userspace_(0), loader_(0), fd_table_(0), state_(Running),
+    wakeup_tick_(0), next_thread_in_lock_waiters_list_(0), lock_waiting_on_(0), holding_lock_list_(0), tid_(0),
     my_terminal_(0), working_dir_(working_dir), name_(name)
 {
   debug(THREAD, "Thread ctor, this is %x, stack is %x\n", this, stack_);
-  debug(THREAD, "sizeof stack is %x; my name: %s\n", sizeof(stack_), name_.c_str());
+  debug(THREAD, "sizeof stack is %x; my name: %s\n", KERNEL_STACK_SIZE, name_.c_str());
   debug(THREAD, "Thread ctor, fs_info ptr: %x\n", working_dir_);
   ArchThreads::createThreadInfosKernelThread(kernel_arch_thread_info_, (pointer) &ThreadStartHack,
                                              getStackStartPointer());
@@ -44,13 +48,17 @@ Thread::~Thread()
 {
   delete loader_;
   loader_ = 0;
+  delete fd_table_;
+  fd_table_ = 0;
   debug(THREAD, "~Thread: freeing ThreadInfos\n");
-  delete user_arch_thread_info_;
+  ThreadCache::instance()->freeThreadInfo(user_arch_thread_info_);
   user_arch_thread_info_ = 0;
-  delete kernel_arch_thread_info_;
+  ThreadCache::instance()->freeThreadInfo(kernel_arch_thread_info_);
   kernel_arch_thread_info_ = 0;
   delete working_dir_;
   working_dir_ = 0;
+  KernelStackManager::instance()->freeStack((pointer) stack_);
+  stack_ = 0;
   if(unlikely(holding_lock_list_ != 0))
   {
     debug(THREAD, "~Thread: ERROR: Thread <%s (%p)> is going to be destroyed, but still holds some locks!\n",
@@ -61,6 +69,16 @@ Thread::~Thread()
   debug(THREAD, "~Thread: done (%s)\n", name_.c_str());
 }
 
+void* Thread::operator new(size_t size)
+{
+  return ThreadCache::instance()->allocThread(size);
+}
+
+void Thread::operator delete(void* thread, size_t size)
+{
+  ThreadCache::instance()->freeThread(thread, size);
+}
+
 //if the Thread we want to kill, is the currentThread, we better not return
 // DO Not use new / delete in this Method, as it sometimes called from an Interrupt Handler with Interrupts disabled
 void Thread::kill()
@@ -83,7 +101,7 @@ void Thread::kill()
 pointer Thread::getStackStartPointer()
 {
   pointer stack = (pointer) stack_;
-  stack += sizeof(stack_) - sizeof(uint32);
+  stack += KERNEL_STACK_SIZE - sizeof(uint32);
   return stack;
 }
 
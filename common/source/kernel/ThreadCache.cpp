@@ -0,0 +1,93 @@
+#include "ThreadCache.h"
+#include "ArchThreads.h"
+#include "kprintf.h"
+#include "assert.h"
+#include "debug.h"
+
+ThreadCache* ThreadCache::instance_ = 0;
+
+ThreadCache* ThreadCache::instance()
+{
+  if (unlikely(!instance_))
+    instance_ = new ThreadCache();
+  return instance_;
+}
+
+ThreadCache::ThreadCache() :
+    num_threads_(0), num_infos_(0), thread_hits_(0), thread_misses_(0), info_hits_(0), info_misses_(0),
+    lock_("ThreadCache::lock_")
+{
+}
+
+void* ThreadCache::allocThread(size_t size)
+{
+  {
+    MutexLock lock(lock_);
+    for (size_t i = num_threads_; i > 0; --i)
+    {
+      if (threads_[i - 1].size == size)
+      {
+        void* memory = threads_[i - 1].memory;
+        threads_[i - 1] = threads_[--num_threads_];
+        ++thread_hits_;
+        return memory;
+      }
+    }
+    ++thread_misses_;
+  }
+  return new uint8[size];
+}
+
+void ThreadCache::freeThread(void* thread, size_t size)
+{
+  {
+    MutexLock lock(lock_);
+    if (num_threads_ < THREAD_CACHE_SIZE)
+    {
+      threads_[num_threads_].memory = thread;
+      threads_[num_threads_].size = size;
+      ++num_threads_;
+      return;
+    }
+  }
+  delete[] (uint8*) thread;
+}
+
+ArchThreadInfo* ThreadCache::allocThreadInfo()
+{
+  {
+    MutexLock lock(lock_);
+    if (num_infos_)
+    {
+      ++info_hits_;
+      return infos_[--num_infos_];
+    }
+    ++info_misses_;
+  }
+  return (ArchThreadInfo*) new uint8[sizeof(ArchThreadInfo)];
+}
+
+void ThreadCache::freeThreadInfo(ArchThreadInfo* info)
+{
+  if (!info)
+    return;
+  {
+    MutexLock lock(lock_);
+    if (num_infos_ < 2 * THREAD_CACHE_SIZE)
+    {
+      infos_[num_infos_++] = info;
+      return;
+    }
+  }
+  delete[] (uint8*) info;
+}
+
+void ThreadCache::printStatistics()
+{
+  size_t threads = thread_hits_ + thread_misses_;
+  size_t infos = info_hits_ + info_misses_;
+  kprintfd("ThreadCache: threads: %d of %d allocations recycled (%d%%), %d cached\n", thread_hits_, threads,
+           threads ? thread_hits_ * 100 / threads : 0, num_threads_);
+  kprintfd("ThreadCache: thread infos: %d of %d allocations recycled (%d%%), %d cached\n", info_hits_, infos,
+           infos ? info_hits_ * 100 / infos : 0, num_infos_);
+}
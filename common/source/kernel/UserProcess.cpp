@@ -5,15 +5,26 @@
 #include "Loader.h"
 #include "VfsSyscall.h"
 #include "File.h"
+#include "FileDescriptor.h"
 
 UserProcess::UserProcess(const char *minixfs_filename, FileSystemInfo *fs_info, ProcessRegistry *process_registry,
                          uint32 terminal_number) :
     Thread(fs_info, minixfs_filename), run_me_(false), terminal_number_(terminal_number),
-    fd_(VfsSyscall::open(minixfs_filename, O_RDONLY)), process_registry_(process_registry)
+    file_descriptor_(0), process_registry_(process_registry)
 {
   process_registry_->processStart(); //should also be called if you fork a process
+  fd_table_ = new FileDescriptorTable();
 
-  if (fd_ < 0)
+  // the executable is opened in the table of the creating thread, the process only keeps a reference
+  int32 fd = VfsSyscall::open(minixfs_filename, O_RDONLY);
+  if (fd >= 0)
+  {
+    file_descriptor_ = FileDescriptorTable::current()->get(fd);
+    file_descriptor_->addRef();
+    VfsSyscall::close(fd);
+  }
+
+  if (!file_descriptor_)
   {
     debug(USERPROCESS, "Error: file %s does not exist!\n", minixfs_filename);
     loader_ = 0;
@@ -21,7 +32,7 @@ UserProcess::UserProcess(const char *minixfs_filename, FileSystemInfo *fs_info,
     return;
   }
 
-  loader_ = new Loader(fd_, this);
+  loader_ = new Loader(file_descriptor_, this);
   if (loader_ && loader_->loadExecutableAndInitProcess())
   {
     run_me_ = true;
@@ -34,12 +45,10 @@ UserProcess::UserProcess(const char *minixfs_filename, FileSystemInfo *fs_info,
   switch_to_userspace_ = 1;
 }
 
-extern VfsSyscall vfs_syscall;
-
 UserProcess::~UserProcess()
 {
-  if (fd_ > 0)
-    vfs_syscall.close(fd_);
+  if (file_descriptor_)
+    FileDescriptor::release(file_descriptor_);
 
   process_registry_->processExit();
 }
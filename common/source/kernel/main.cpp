@@ -4,6 +4,8 @@
 #include "BDManager.h"
 #include "BDVirtualDevice.h"
 #include "PageManager.h"
+#include "SwapManager.h"
+#include "BlockCache.h"
 #include "KernelMemoryManager.h"
 #include "ArchInterrupts.h"
 #include "ArchThreads.h"
@@ -88,12 +90,6 @@ extern "C" void startup()
     debug(MAIN, "Detected Device: %s :: %d\n", bdvd->getName(), bdvd->getDeviceNumber());
   }
 
-  // initialise global and static objects
-  extern ustl::list<FileDescriptor*> global_fd;
-  new (&global_fd) ustl::list<FileDescriptor*>();
-  extern Mutex global_fd_lock;
-  new (&global_fd_lock) Mutex("global_fd_lock");
-
   debug(MAIN, "make a deep copy of FsWorkingDir\n");
   main_console->setWorkingDirInfo(new FileSystemInfo(*default_working_dir));
   debug(MAIN, "main_console->setWorkingDirInfo done\n");
@@ -114,6 +110,8 @@ extern "C" void startup()
   ArchInterrupts::enableKBD();
 
   debug(MAIN, "Adding Kernel threads\n");
+  SwapManager::init();
+  BlockCache::instance()->startReadAhead();
   Scheduler::instance()->addNewThread(main_console);
   Scheduler::instance()->addNewThread(new ProcessRegistry(new FileSystemInfo(*default_working_dir), user_progs /*see user_progs.h*/));
   Scheduler::instance()->printThreadList();
@@ -414,22 +414,28 @@ pointer KernelMemoryManager::ksbrk(ssize_t size)
     if(size > 0)
     {
       debug(KMM, "%x != %x\n", cur_top_vpn, new_top_vpn);
+      size_t new_pages[KSBRK_BATCH_PAGES];
       while(cur_top_vpn != new_top_vpn)
       {
         debug(KMM, "%x != %x\n", cur_top_vpn, new_top_vpn);
-        cur_top_vpn++;
+        size_t num_pages = Min(new_top_vpn - cur_top_vpn, (size_t) KSBRK_BATCH_PAGES);
         assert(pm_ready_);
-        size_t new_page = PageManager::instance()->allocPPN();
-        if(unlikely(new_page == 0))
+        for (size_t i = 0; i < num_pages; ++i)
         {
-          debug(KMM, "KernelMemoryManager::ksbrk(%d)4\n", size);
-          kprintfd("KernelMemoryManager::freeSegment: FATAL ERROR\n");
-          kprintfd("KernelMemoryManager::freeSegment: no more physical memory\n");
-          prenew_assert(new_page != 0);
+          new_pages[i] = PageManager::instance()->allocPPN();
+          if(unlikely(new_pages[i] == 0))
+          {
+            debug(KMM, "KernelMemoryManager::ksbrk(%d)4\n", size);
+            kprintfd("KernelMemoryManager::freeSegment: FATAL ERROR\n");
+            kprintfd("KernelMemoryManager::freeSegment: no more physical memory\n");
+            prenew_assert(new_pages[i] != 0);
+          }
+          memset((void*)ArchMemory::getIdentAddressOfPPN(new_pages[i]), 0 , PAGE_SIZE);
         }
-        debug(KMM, "kbsrk: map %x -> %x\n", cur_top_vpn, new_page);
-        memset((void*)ArchMemory::getIdentAddressOfPPN(new_page), 0 , PAGE_SIZE);
-        ArchMemory::mapKernelPage(cur_top_vpn, new_page);
+        debug(KMM, "kbsrk: map %d pages from %x\n", num_pages, cur_top_vpn + 1);
+        // one page table walk per batch instead of one per page
+        ArchMemory::mapKernelRange(cur_top_vpn + 1, num_pages, new_pages);
+        cur_top_vpn += num_pages;
       }
 
     }
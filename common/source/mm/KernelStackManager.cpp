@@ -0,0 +1,84 @@
+#include "KernelStackManager.h"
+#include "PageManager.h"
+#include "ArchMemory.h"
+#include "Bitmap.h"
+#include "kprintf.h"
+#include "assert.h"
+#include "debug.h"
+
+KernelStackManager* KernelStackManager::instance_ = 0;
+
+KernelStackManager* KernelStackManager::instance()
+{
+  if (unlikely(!instance_))
+    instance_ = new KernelStackManager();
+  return instance_;
+}
+
+KernelStackManager::KernelStackManager() :
+    num_slots_((ArchMemory::KERNEL_STACKS_END - ArchMemory::KERNEL_STACKS_START) /
+               (KERNEL_STACK_GUARD_PAGES + KERNEL_STACK_PAGES)),
+    next_slot_(0), used_slots_(new Bitmap(num_slots_)), num_cached_(0), lock_("KernelStackManager::lock_")
+{
+  debug(KSTACK, "ctor: %d stack slots from %x to %x\n", num_slots_, ArchMemory::KERNEL_STACKS_START * PAGE_SIZE,
+        ArchMemory::KERNEL_STACKS_END * PAGE_SIZE);
+}
+
+size_t KernelStackManager::getStackPage(size_t slot)
+{
+  return ArchMemory::KERNEL_STACKS_START + slot * (KERNEL_STACK_GUARD_PAGES + KERNEL_STACK_PAGES) +
+         KERNEL_STACK_GUARD_PAGES;
+}
+
+pointer KernelStackManager::allocStack()
+{
+  MutexLock lock(lock_);
+  if (num_cached_)
+  {
+    size_t slot = cached_slots_[--num_cached_];
+    debug(KSTACK, "allocStack: reusing cached stack %d\n", slot);
+    return getStackPage(slot) * PAGE_SIZE;
+  }
+
+  if (used_slots_->getNumFreeBits() == 0)
+  {
+    kprintfd("KernelStackManager::allocStack: FATAL ERROR: all %d kernel stacks are in use\n", num_slots_);
+    assert(false);
+  }
+  while (used_slots_->getBit(next_slot_))
+    next_slot_ = (next_slot_ + 1) % num_slots_;
+  size_t slot = next_slot_;
+  used_slots_->setBit(slot);
+
+  size_t pages[KERNEL_STACK_PAGES];
+  for (size_t i = 0; i < KERNEL_STACK_PAGES; ++i)
+    pages[i] = PageManager::instance()->allocPPN();
+  ArchMemory::mapKernelRange(getStackPage(slot), KERNEL_STACK_PAGES, pages);
+  debug(KSTACK, "allocStack: mapped stack %d at %x\n", slot, getStackPage(slot) * PAGE_SIZE);
+  return getStackPage(slot) * PAGE_SIZE;
+}
+
+void KernelStackManager::freeStack(pointer stack)
+{
+  size_t offset = stack / PAGE_SIZE - ArchMemory::KERNEL_STACKS_START - KERNEL_STACK_GUARD_PAGES;
+  size_t slot = offset / (KERNEL_STACK_GUARD_PAGES + KERNEL_STACK_PAGES);
+  assert(stack % PAGE_SIZE == 0 && offset % (KERNEL_STACK_GUARD_PAGES + KERNEL_STACK_PAGES) == 0 &&
+         slot < num_slots_ && "KernelStackManager::freeStack: not a kernel stack");
+
+  MutexLock lock(lock_);
+  assert(used_slots_->getBit(slot));
+  if (num_cached_ < KERNEL_STACK_CACHE_SIZE)
+  {
+    cached_slots_[num_cached_++] = slot;
+    return;
+  }
+  for (size_t i = 0; i < KERNEL_STACK_PAGES; ++i)
+    ArchMemory::unmapKernelPage(getStackPage(slot) + i);
+  used_slots_->unsetBit(slot);
+  debug(KSTACK, "freeStack: unmapped stack %d\n", slot);
+}
+
+size_t KernelStackManager::getNumCachedStacks()
+{
+  return num_cached_;
+}
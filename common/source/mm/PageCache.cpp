@@ -0,0 +1,226 @@
+#include "PageCache.h"
+#include "PageManager.h"
+#include "ArchMemory.h"
+#include "Inode.h"
+#include "kprintf.h"
+#include "assert.h"
+#include "debug.h"
+#include "kstring.h"
+#include "uvector.h"
+#include "Thread.h"
+
+PageCache* PageCache::instance_ = 0;
+
+PageCache* PageCache::instance()
+{
+  if (unlikely(!instance_))
+    instance_ = new PageCache();
+  return instance_;
+}
+
+PageCache::PageCache() :
+    num_cached_pages_(0), lock_("PageCache::lock_"), page_loaded_(&lock_, "PageCache::page_loaded_")
+{
+}
+
+PageCache::InodePages* PageCache::getInodePages(Inode* inode)
+{
+  assert(lock_.isHeldBy(currentThread));
+  ustl::map<Inode*, InodePages*>::iterator it = inodes_.find(inode);
+  return it == inodes_.end() ? 0 : it->second;
+}
+
+uint32 PageCache::getPage(Inode* inode, uint32 page_index)
+{
+  assert(inode);
+  MutexLock lock(lock_);
+  InodePages* pages;
+  while (1)
+  {
+    pages = getInodePages(inode);
+    if (!pages)
+    {
+      pages = new InodePages();
+      inodes_[inode] = pages;
+    }
+    InodePages::iterator it = pages->find(page_index);
+    if (it == pages->end())
+      break;
+    if (!it->second.loading)
+    {
+      PageManager::instance()->refPPN(it->second.ppn);
+      return it->second.ppn;
+    }
+    page_loaded_.wait("PageCache::getPage");
+  }
+
+  // the entry keeps others from loading the page too while the lock is dropped for the read
+  uint32 ppn = PageManager::instance()->allocPPN();
+  CachedPage cached = { ppn, false, true, false };
+  (*pages)[page_index] = cached;
+  ++num_cached_pages_;
+
+  char* page = (char*) ArchMemory::getIdentAddressOfPPN(ppn);
+  uint32 offset = page_index * PAGE_SIZE;
+  InodePages::iterator it;
+  bool stale;
+  do
+  {
+    lock_.release("PageCache::getPage");
+    int32 read = 0;
+    if (offset < inode->getSize())
+      read = inode->readData(offset, Min(inode->getSize() - offset, (uint32) PAGE_SIZE), page);
+    if (read < 0)
+      read = 0;
+    memset(page + read, 0, PAGE_SIZE - read);
+    debug(PAGECACHE, "getPage: loaded page %d of inode %p into ppn %x (%d bytes)\n", page_index, inode, ppn, read);
+    lock_.acquire("PageCache::getPage");
+    // the map may have been changed meanwhile, but nobody removes a loading page
+    it = pages->find(page_index);
+    assert(it != pages->end() && it->second.ppn == ppn);
+    // a write during the read may not be part of what has been read
+    stale = it->second.stale;
+    it->second.stale = false;
+  } while (stale);
+  it->second.loading = false;
+  page_loaded_.broadcast("PageCache::getPage");
+
+  PageManager::instance()->refPPN(ppn);
+  return ppn;
+}
+
+void PageCache::markDirty(Inode* inode, uint32 page_index)
+{
+  MutexLock lock(lock_);
+  InodePages* pages = getInodePages(inode);
+  if (!pages)
+    return;
+  InodePages::iterator it = pages->find(page_index);
+  if (it != pages->end())
+    it->second.dirty = true;
+}
+
+void PageCache::writeBack(Inode* inode, uint32 first_page, uint32 num_pages)
+{
+  ustl::vector<ustl::pair<uint32, uint32> > dirty_pages;
+  {
+    MutexLock lock(lock_);
+    InodePages* pages = getInodePages(inode);
+    if (!pages)
+      return;
+    for (InodePages::iterator it = pages->lower_bound(first_page);
+         it != pages->end() && it->first < first_page + num_pages; ++it)
+    {
+      if (!it->second.dirty || it->second.loading)
+        continue;
+      it->second.dirty = false;
+      // keep the page alive while it is written without holding the lock,
+      // writeData calls updateFromWrite
+      PageManager::instance()->refPPN(it->second.ppn);
+      dirty_pages.push_back(ustl::make_pair(it->first, it->second.ppn));
+    }
+  }
+
+  for (size_t i = 0; i < dirty_pages.size(); ++i)
+  {
+    uint32 offset = dirty_pages[i].first * PAGE_SIZE;
+    uint32 size = inode->getSize();
+    // mappings never extend the file
+    if (offset < size)
+    {
+      size = Min(size - offset, (uint32) PAGE_SIZE);
+      debug(PAGECACHE, "writeBack: page %d of inode %p (%d bytes)\n", dirty_pages[i].first, inode, size);
+      inode->writeData(offset, size, (const char*) ArchMemory::getIdentAddressOfPPN(dirty_pages[i].second));
+    }
+    PageManager::instance()->freePPN(dirty_pages[i].second);
+  }
+}
+
+void PageCache::updateFromWrite(Inode* inode, uint32 offset, uint32 size, const char* buffer)
+{
+  MutexLock lock(lock_);
+  InodePages* pages = getInodePages(inode);
+  if (!pages)
+    return;
+  uint32 end = offset + size;
+  for (InodePages::iterator it = pages->lower_bound(offset / PAGE_SIZE);
+       it != pages->end() && it->first * PAGE_SIZE < end; ++it)
+  {
+    if (it->second.loading)
+    {
+      it->second.stale = true;
+      continue;
+    }
+    uint32 page_start = it->first * PAGE_SIZE;
+    uint32 from = Max(page_start, offset);
+    uint32 to = Min(page_start + PAGE_SIZE, end);
+    char* dst = (char*) ArchMemory::getIdentAddressOfPPN(it->second.ppn) + (from - page_start);
+    const char* src = buffer + (from - offset);
+    if (dst != src)
+      memcpy(dst, src, to - from);
+  }
+}
+
+void PageCache::invalidateInode(Inode* inode)
+{
+  MutexLock lock(lock_);
+  InodePages* pages;
+  bool loading = true;
+  while ((pages = getInodePages(inode)) && loading)
+  {
+    loading = false;
+    for (InodePages::iterator it = pages->begin(); it != pages->end() && !loading; ++it)
+      loading = it->second.loading;
+    if (loading)
+      page_loaded_.wait("PageCache::invalidateInode");
+  }
+  if (!pages)
+    return;
+  for (InodePages::iterator it = pages->begin(); it != pages->end(); ++it)
+  {
+    PageManager::instance()->freePPN(it->second.ppn);
+    --num_cached_pages_;
+  }
+  inodes_.erase(inode);
+  delete pages;
+}
+
+uint32 PageCache::reclaim(uint32 max_pages)
+{
+  if (!lock_.acquireNonBlocking("PageCache::reclaim"))
+    return 0;
+  uint32 num_freed = 0;
+  ustl::map<Inode*, InodePages*>::iterator inode_it = inodes_.begin();
+  while (inode_it != inodes_.end() && num_freed < max_pages)
+  {
+    InodePages* pages = inode_it->second;
+    InodePages::iterator it = pages->begin();
+    while (it != pages->end() && num_freed < max_pages)
+    {
+      if (it->second.dirty || it->second.loading || PageManager::instance()->getRefCount(it->second.ppn) != 1)
+      {
+        ++it;
+        continue;
+      }
+      PageManager::instance()->freePPN(it->second.ppn);
+      --num_cached_pages_;
+      ++num_freed;
+      it = pages->erase(it);
+    }
+    if (pages->empty())
+    {
+      delete pages;
+      inode_it = inodes_.erase(inode_it);
+    }
+    else
+      ++inode_it;
+  }
+  lock_.release("PageCache::reclaim");
+  debug(PAGECACHE, "reclaim: freed %d pages, %d pages cached\n", num_freed, num_cached_pages_);
+  return num_freed;
+}
+
+uint32 PageCache::getNumCachedPages()
+{
+  return num_cached_pages_;
+}
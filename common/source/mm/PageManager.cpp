@@ -9,7 +9,9 @@
 #include "ArchInterrupts.h"
 #include "KernelMemoryManager.h"
 #include "assert.h"
+#include "kstring.h"
 #include "Bitmap.h"
+#include "SwapManager.h"
 
 PageManager pm;
 
@@ -76,7 +78,9 @@ PageManager::PageManager() : lock_("PageManager::lock_")
     prenew_assert(false);
   }
 
-  size_t num_pages_for_bitmap = (number_of_pages_ / 8) / PAGE_SIZE + 1;
+  // the heap cannot grow before the PageManager is ready, so reserve it for the
+  // bitmap and the reference counts of the pages up front
+  size_t num_pages_for_bitmap = (number_of_pages_ / 8 + number_of_pages_ * sizeof(uint16)) / PAGE_SIZE + 2;
   size_t start_vpn = ArchCommon::getFreeKernelMemoryStart() / PAGE_SIZE;
   size_t last_free_page = number_of_pages_-1;
   size_t temp_page_size = 0;
@@ -90,8 +94,15 @@ PageManager::PageManager() : lock_("PageManager::lock_")
     start_vpn++;
   }
   extern KernelMemoryManager kmm;
-  new (&kmm) KernelMemoryManager(num_reserved_heap_pages,MAX_HEAP_PAGES);
+  // the kernel heap must not grow into the kernel stacks: the stacks take the last 4 MiB of the
+  // 16 MiB covered by the kernel page tables, so the heap is capped below 12 MiB minus the kernel
+  // image, not at MAX_HEAP_PAGES
+  size_t max_heap_pages = Min((size_t) MAX_HEAP_PAGES,
+                              ArchMemory::KERNEL_STACKS_START - ArchCommon::getFreeKernelMemoryStart() / PAGE_SIZE);
+  new (&kmm) KernelMemoryManager(num_reserved_heap_pages,max_heap_pages);
   page_usage_table_ = new Bitmap(number_of_pages_);
+  page_ref_counts_ = new uint16[number_of_pages_];
+  memset(page_ref_counts_, 0, number_of_pages_ * sizeof(uint16));
 
   // since we have gaps in the memory maps we can not give out everything
   // first mark everything as reserved, just to be sure
@@ -171,6 +182,11 @@ uint32 PageManager::getTotalNumPages() const
   return number_of_pages_;
 }
 
+uint32 PageManager::getNumFreePages() const
+{
+  return page_usage_table_->getNumFreeBits();
+}
+
 bool PageManager::reservePages(uint32 ppn, uint32 num)
 {
   assert(lock_.heldBy() == currentThread);
@@ -200,10 +216,19 @@ uint32 PageManager::allocPPN(uint32 page_size)
       if (reservePages(p, page_size / PAGE_SIZE))
         found = p;
     }
+    if (found)
+      for (uint32 r = found; r < found + page_size / PAGE_SIZE; ++r)
+        page_ref_counts_[r] = 1;
     while (lowest_unreserved_page_ < number_of_pages_ && page_usage_table_->getBit(lowest_unreserved_page_))
       ++lowest_unreserved_page_;
     lock_.release();
 
+    SwapManager* swap = SwapManager::instance();
+    if (swap && getNumFreePages() < SWAP_LOW_WATERMARK)
+      swap->wakeUp();
+    if (found == 0 && swap && swap->waitForFreePages())
+      continue;
+
     if (found == 0)
     {
       debug(PM, "PageManager::allocPPN: FATAL ERROR!\n");
@@ -219,12 +244,39 @@ void PageManager::freePPN(uint32 page_number, uint32 page_size)
 {
   assert((page_size % PAGE_SIZE) == 0);
   lock_.acquire();
+  if (page_ref_counts_[page_number] > 1)
+  {
+    // the page is still referenced by someone else (shared mapping, page cache)
+    for (uint32 p = page_number; p < (page_number + page_size / PAGE_SIZE); ++p)
+      --page_ref_counts_[p];
+    lock_.release();
+    return;
+  }
   if (page_number < lowest_unreserved_page_)
     lowest_unreserved_page_ = page_number;
   for (uint32 p = page_number; p < (page_number + page_size / PAGE_SIZE); ++p)
   {
     assert(page_usage_table_->getBit(p))
     page_usage_table_->unsetBit(p);
+    page_ref_counts_[p] = 0;
   }
   lock_.release();
 }
+
+void PageManager::refPPN(uint32 page_number)
+{
+  lock_.acquire();
+  assert(page_number < number_of_pages_ && page_usage_table_->getBit(page_number));
+  if (page_ref_counts_[page_number] == 0)
+    page_ref_counts_[page_number] = 1;
+  assert(page_ref_counts_[page_number] < 0xFFFF && "too many references to a single page");
+  ++page_ref_counts_[page_number];
+  lock_.release();
+}
+
+uint32 PageManager::getRefCount(uint32 page_number)
+{
+  if (page_number >= number_of_pages_ || !page_usage_table_->getBit(page_number))
+    return 0;
+  return page_ref_counts_[page_number] ? page_ref_counts_[page_number] : 1;
+}
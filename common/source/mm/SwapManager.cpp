@@ -0,0 +1,249 @@
+#include "SwapManager.h"
+#include "PageManager.h"
+#include "ArchMemory.h"
+#include "ArchInterrupts.h"
+#include "BDManager.h"
+#include "BDVirtualDevice.h"
+#include "Bitmap.h"
+#include "KernelMemoryManager.h"
+#include "Loader.h"
+#include "PageCache.h"
+#include "Scheduler.h"
+#include "SwapThread.h"
+#include "kstring.h"
+#include "kprintf.h"
+#include "assert.h"
+#include "debug.h"
+
+SwapManager* SwapManager::instance_ = 0;
+
+SwapManager* SwapManager::instance()
+{
+  return instance_;
+}
+
+void SwapManager::init()
+{
+  assert(!instance_);
+  for (BDVirtualDevice* bdvd : BDManager::getInstance()->device_list_)
+  {
+    if (bdvd->getPartitionType() == SWAP_PARTITION_TYPE)
+    {
+      instance_ = new SwapManager(bdvd);
+      Scheduler::instance()->addNewThread(instance_->swap_thread_);
+      debug(SWAP, "init: swapping to %s, %d slots\n", bdvd->getName(), instance_->getNumFreeSlots());
+      return;
+    }
+  }
+  debug(SWAP, "init: no swap partition found, swapping disabled\n");
+}
+
+SwapManager::SwapManager(BDVirtualDevice* device) :
+    device_(device), num_pages_(PageManager::instance()->getTotalNumPages()), clock_hand_(0),
+    lock_("SwapManager::lock_"), pass_done_(&lock_, "SwapManager::pass_done_"), reclaiming_(false),
+    reclaim_passes_(0), last_num_reclaimed_(0)
+{
+  size_t num_slots = device_->getNumBlocks() / (PAGE_SIZE / device_->getBlockSize());
+  slots_ = new Bitmap(num_slots);
+  slots_->setBit(0); // 0 means "not swapped", never hand it out
+  slot_owners_ = new Loader*[num_slots];
+  memset(slot_owners_, 0, num_slots * sizeof(Loader*));
+  rmap_ = new ReverseMapping[num_pages_];
+  memset(rmap_, 0, num_pages_ * sizeof(ReverseMapping));
+  memset(waiters_, 0, sizeof(waiters_));
+  swap_thread_ = new SwapThread();
+}
+
+void SwapManager::addPage(uint32 ppn, Loader* owner, size_t virtual_page)
+{
+  MutexLock lock(lock_);
+  assert(ppn < num_pages_);
+  rmap_[ppn].owner = owner;
+  rmap_[ppn].virtual_page = virtual_page;
+}
+
+void SwapManager::removeAddressSpace(Loader* owner)
+{
+  MutexLock lock(lock_);
+  for (uint32 ppn = 0; ppn < num_pages_; ++ppn)
+  {
+    if (rmap_[ppn].owner == owner)
+      rmap_[ppn].owner = 0;
+  }
+  for (size_t slot = 1; slot < slots_->getSize(); ++slot)
+  {
+    if (slot_owners_[slot] == owner)
+    {
+      slot_owners_[slot] = 0;
+      slots_->unsetBit(slot);
+    }
+  }
+}
+
+bool SwapManager::swapIn(size_t swap_slot, uint32 ppn)
+{
+  assert(swap_slot && swap_slot < slots_->getSize());
+  // the slot belongs to the page table entry of the caller, nobody else touches it
+  int32 read = device_->readData(swap_slot * PAGE_SIZE, PAGE_SIZE, (char*) ArchMemory::getIdentAddressOfPPN(ppn));
+  debug(SWAP, "swapIn: slot %d -> ppn %x\n", swap_slot, ppn);
+  freeSlot(swap_slot);
+  return read == PAGE_SIZE;
+}
+
+void SwapManager::freeSlot(size_t swap_slot)
+{
+  MutexLock lock(lock_);
+  assert(swap_slot && slots_->getBit(swap_slot));
+  slot_owners_[swap_slot] = 0;
+  slots_->unsetBit(swap_slot);
+}
+
+size_t SwapManager::allocSlot()
+{
+  assert(lock_.isHeldBy(currentThread));
+  if (slots_->getNumFreeBits() == 0)
+    return 0;
+  for (size_t slot = 1; slot < slots_->getSize(); ++slot)
+  {
+    if (!slots_->getBit(slot))
+    {
+      slots_->setBit(slot);
+      return slot;
+    }
+  }
+  return 0;
+}
+
+uint32 SwapManager::getNumFreeSlots()
+{
+  return slots_->getNumFreeBits();
+}
+
+void SwapManager::wakeUp()
+{
+  if (!swap_thread_->hasWork())
+    swap_thread_->addJob();
+}
+
+bool SwapManager::isWaiting(Thread* thread)
+{
+  for (size_t i = 0; i < SWAP_MAX_WAITERS; ++i)
+  {
+    if (waiters_[i] == thread)
+      return true;
+  }
+  return false;
+}
+
+bool SwapManager::waitForFreePages()
+{
+  // the swap thread allocates kernel memory itself, so a thread growing the kernel heap must not wait for it
+  if (!currentThread || currentThread == swap_thread_ || !ArchInterrupts::testIFSet() ||
+      lock_.isHeldBy(currentThread) || KernelMemoryManager::instance()->KMMLockHeldBy() == currentThread)
+    return false;
+
+  MutexLock lock(lock_);
+  size_t waiter = SWAP_MAX_WAITERS;
+  for (size_t i = 0; i < SWAP_MAX_WAITERS && waiter == SWAP_MAX_WAITERS; ++i)
+  {
+    if (!waiters_[i])
+    {
+      waiters_[i] = currentThread;
+      waiter = i;
+    }
+  }
+  // a pass which is running already might have missed that we are waiting, wait for the next one
+  size_t end_pass = reclaim_passes_ + (reclaiming_ ? 2 : 1);
+
+  debug(SWAP, "waitForFreePages: %s waits for free pages\n", currentThread->getName());
+  swap_thread_->addJob();
+  while (reclaim_passes_ < end_pass)
+    pass_done_.wait("SwapManager::waitForFreePages");
+
+  if (waiter != SWAP_MAX_WAITERS)
+    waiters_[waiter] = 0;
+  return last_num_reclaimed_ > 0 || PageManager::instance()->getNumFreePages() > 0;
+}
+
+void SwapManager::reclaim()
+{
+  MutexLock lock(lock_);
+  reclaiming_ = true;
+  // cached file pages nobody maps are dropped before anything is swapped out
+  uint32 num_free = PageManager::instance()->getNumFreePages();
+  if (num_free < SWAP_HIGH_WATERMARK)
+    PageCache::instance()->reclaim(SWAP_HIGH_WATERMARK - num_free);
+  size_t num_reclaimed = 0;
+  // two rounds: the first one might only clear the accessed flags
+  for (size_t scanned = 0; scanned < 2 * num_pages_ &&
+       PageManager::instance()->getNumFreePages() < SWAP_HIGH_WATERMARK; ++scanned)
+  {
+    uint32 ppn = clock_hand_;
+    clock_hand_ = (clock_hand_ + 1) % num_pages_;
+    if (rmap_[ppn].owner && reclaimPage(ppn))
+      ++num_reclaimed;
+  }
+  debug(SWAP, "reclaim: swapped out %d pages, %d pages free, %d slots free\n", num_reclaimed,
+        PageManager::instance()->getNumFreePages(), getNumFreeSlots());
+  last_num_reclaimed_ = num_reclaimed;
+  ++reclaim_passes_;
+  reclaiming_ = false;
+  pass_done_.broadcast("SwapManager::reclaim");
+}
+
+bool SwapManager::reclaimPage(uint32 ppn)
+{
+  Loader* owner = rmap_[ppn].owner;
+  size_t virtual_page = rmap_[ppn].virtual_page;
+
+  // a thread waiting for free pages while holding the lock of its address space
+  // does not touch the page tables until we are done
+  bool locked = owner->load_lock_.acquireNonBlocking("SwapManager::reclaimPage");
+  if (!locked && !isWaiting(owner->load_lock_.heldBy()))
+    return false;
+
+  bool reclaimed = false;
+  ArchMemory& arch_memory = owner->arch_memory_;
+  if (arch_memory.getMappedPPN(virtual_page) != ppn || PageManager::instance()->getRefCount(ppn) != 1)
+  {
+    // the page has been unmapped or shared in the meantime
+    rmap_[ppn].owner = 0;
+  }
+  else if (!arch_memory.testAndClearAccessed(virtual_page))
+  {
+    size_t slot = allocSlot();
+    if (slot)
+    {
+      // unmap first, so nobody writes to the page while it is written out
+      size_t writeable = arch_memory.isPageWriteable(virtual_page);
+      arch_memory.setPageSwapped(virtual_page, slot);
+      // the address space stays locked (or its owner waits for us), so the page table
+      // entry is not touched meanwhile; other users of the swap manager go on
+      rmap_[ppn].owner = 0;
+      lock_.release("SwapManager::reclaimPage");
+      int32 written = device_->writeData(slot * PAGE_SIZE, PAGE_SIZE, (char*) ArchMemory::getIdentAddressOfPPN(ppn));
+      lock_.acquire("SwapManager::reclaimPage");
+      if (written == PAGE_SIZE)
+      {
+        slot_owners_[slot] = owner;
+        reclaimed = true;
+      }
+      else
+      {
+        debug(SWAP, "reclaimPage: writing slot %d failed\n", slot);
+        arch_memory.mapPage(virtual_page, ppn, 1);
+        // read-only text and copy on write pages stay read-only
+        if (!writeable)
+          arch_memory.setPageWriteable(virtual_page, 0);
+        rmap_[ppn].owner = owner;
+        slots_->unsetBit(slot);
+      }
+    }
+  }
+
+  if (locked)
+    owner->load_lock_.release("SwapManager::reclaimPage");
+  if (reclaimed)
+    PageManager::instance()->freePPN(ppn);
+  return reclaimed;
+}
@@ -0,0 +1,70 @@
+#include "VmaTree.h"
+#include "assert.h"
+
+size_t VmaTree::lowerBound(size_t virtual_page)
+{
+  size_t low = 0;
+  size_t high = areas_.size();
+  while (low < high)
+  {
+    size_t middle = (low + high) / 2;
+    if (areas_[middle].end_page <= virtual_page)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+VirtualMemoryArea* VmaTree::find(size_t virtual_page)
+{
+  size_t index = lowerBound(virtual_page);
+  if (index < areas_.size() && areas_[index].start_page <= virtual_page)
+    return &areas_[index];
+  return 0;
+}
+
+bool VmaTree::isFree(size_t start_page, size_t end_page)
+{
+  size_t index = lowerBound(start_page);
+  return index == areas_.size() || areas_[index].start_page >= end_page;
+}
+
+void VmaTree::insert(const VirtualMemoryArea& area)
+{
+  assert(area.start_page < area.end_page);
+  size_t index = lowerBound(area.start_page);
+  assert((index == areas_.size() || areas_[index].start_page >= area.end_page) && "VmaTree::insert: areas overlap");
+  areas_.insert(areas_.begin() + index, area);
+}
+
+void VmaTree::erase(size_t index)
+{
+  assert(index < areas_.size());
+  areas_.erase(areas_.begin() + index);
+}
+
+size_t VmaTree::findFreeRange(size_t num_pages, size_t low_page, size_t high_page, size_t guard_pages)
+{
+  size_t end_page = high_page;
+  size_t index = lowerBound(high_page);
+  if (index < areas_.size() && areas_[index].start_page < high_page)
+  {
+    // an area reaching beyond high_page
+    if (areas_[index].start_page < low_page + 2 * guard_pages + num_pages)
+      return 0;
+    end_page = areas_[index].start_page - guard_pages;
+  }
+  for (; index > 0; --index)
+  {
+    VirtualMemoryArea& below = areas_[index - 1];
+    if (below.end_page <= low_page || below.end_page + guard_pages + num_pages <= end_page)
+      break;
+    if (below.start_page < low_page + 2 * guard_pages + num_pages)
+      return 0;
+    end_page = below.start_page - guard_pages;
+  }
+  if (end_page < low_page + guard_pages + num_pages)
+    return 0;
+  return end_page - num_pages;
+}
@@ -16,10 +16,17 @@ extern "C" {
 #define MAP_SHARED    0x40000000  // 0100..
 #define MAP_ANONYMOUS 0x80000000  // 1000..
 
+#define MAP_FAILED    ((void*) -1)
+
+#define MS_ASYNC      0x00000001
+#define MS_SYNC       0x00000004
+
 extern void* mmap(void* start, size_t length, int prot, int flags, int fd, off_t offset);
 
 extern int munmap(void* start, size_t length);
 
+extern int msync(void* start, size_t length, int flags);
+
 extern int shm_open(const char* name, int oflag, mode_t mode);
 
 extern int shm_unlink(const char* name);
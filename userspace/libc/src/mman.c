@@ -1,22 +1,52 @@
 #include "sys/mman.h"
+#include "sys/syscall.h"
+#include "../../../common/include/kernel/syscall-definitions.h"
 
 /**
- * function stub
- * posix compatible signature - do not change the signature!
+ * Maps a file (or anonymous memory if MAP_ANONYMOUS is set) into the address
+ * space of the calling process. The start address is only a hint and ignored.
+ * The six arguments are passed in memory, they do not fit into the syscall registers.
+ *
+ * @param start ignored
+ * @param length the length of the mapping in bytes
+ * @param prot PROT_READ and/or PROT_WRITE
+ * @param flags MAP_SHARED or MAP_PRIVATE, optionally ored with MAP_ANONYMOUS
+ * @param fd the file to map
+ * @param offset the page aligned offset within the file
+ * @return the start address of the mapping, MAP_FAILED on failure
  */
 void* mmap(void* start, size_t length, int prot, int flags, int fd,
            off_t offset)
 {
-  return 0;
+  size_t args[6] = { (size_t) start, length, prot, flags, fd, offset };
+  return (void*) __syscall(sc_mmap, (long) args, 0x00, 0x00, 0x00, 0x00);
 }
 
 /**
- * function stub
- * posix compatible signature - do not change the signature!
+ * Removes the mappings of the given range, modified pages of shared file
+ * mappings are written back to the file.
+ *
+ * @param start the page aligned start address
+ * @param length the length of the range in bytes
+ * @return 0 on success, -1 on failure
  */
 int munmap(void* start, size_t length)
 {
-  return -1;
+  return __syscall(sc_munmap, (long) start, length, 0x00, 0x00, 0x00);
+}
+
+/**
+ * Writes modified pages of shared file mappings in the given range back to
+ * their files.
+ *
+ * @param start the page aligned start address
+ * @param length the length of the range in bytes
+ * @param flags MS_SYNC or MS_ASYNC
+ * @return 0 on success, -1 on failure
+ */
+int msync(void* start, size_t length, int flags)
+{
+  return __syscall(sc_msync, (long) start, length, flags, 0x00, 0x00);
 }
 
 /**
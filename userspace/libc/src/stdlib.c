@@ -1,12 +1,149 @@
 #include "stdlib.h"
+#include "string.h"
+#include "unistd.h"
+#include "sys/mman.h"
+
+/**
+ * Memory allocator
+ *
+ * Small blocks (up to MALLOC_MAX_SMALL bytes including the header) are taken
+ * from size class bins. Every bin is a singly linked list of free blocks of
+ * one size, malloc and free only push/pop a list head. Empty bins are refilled
+ * from a bump region which grows the heap with sbrk in MALLOC_HEAP_GROW steps.
+ * Freed small blocks stay in their bin and are never given back to the kernel.
+ *
+ * Large blocks get their own anonymous mapping, which is unmapped by free.
+ *
+ * Every block starts with a header which holds its size class (small blocks)
+ * or the length of its mapping (large blocks).
+ */
+
+#define MALLOC_ALIGNMENT   8
+#define MALLOC_MAX_SMALL   2048
+#define MALLOC_NUM_CLASSES 16
+#define MALLOC_HEAP_GROW   (64 * 1024)
+#define MALLOC_PAGE_SIZE   4096
+#define MALLOC_LARGE       0x80000000U
+
+typedef struct
+{
+  size_t info; // size class index or MALLOC_LARGE | mapping length
+  size_t padding; // keeps the payload 8 byte aligned
+} malloc_header;
+
+typedef struct malloc_free_block
+{
+  struct malloc_free_block* next;
+} malloc_free_block;
+
+/**
+ * block sizes (including the header) of the size classes
+ */
+static const size_t malloc_class_sizes[MALLOC_NUM_CLASSES] =
+{
+  16, 32, 48, 64, 80, 96, 112, 128, 192, 256, 384, 512, 768, 1024, 1536, 2048
+};
+
+/**
+ * the bins, userspace processes have a single thread so one set of bins
+ * is local to that thread
+ */
+static malloc_free_block* malloc_bins[MALLOC_NUM_CLASSES];
+
+/**
+ * maps (size + 15) / 16 to the smallest fitting size class
+ */
+static unsigned char malloc_class_of[MALLOC_MAX_SMALL / 16 + 1];
+static int malloc_initialized = 0;
+
+static char* malloc_bump = 0;
+static char* malloc_bump_end = 0;
+
+static void malloc_init()
+{
+  size_t size_class = 0;
+  size_t i;
+  for (i = 0; i <= MALLOC_MAX_SMALL / 16; ++i)
+  {
+    while (malloc_class_sizes[size_class] < i * 16)
+      ++size_class;
+    malloc_class_of[i] = size_class;
+  }
+  malloc_initialized = 1;
+}
+
+static malloc_header* malloc_refill(size_t size_class)
+{
+  size_t block_size = malloc_class_sizes[size_class];
+  if (malloc_bump + block_size > malloc_bump_end)
+  {
+    char* region = sbrk(MALLOC_HEAP_GROW);
+    if (region == (char*) -1)
+      return 0;
+    // someone else moved the break, the rest of the old region is lost
+    if (region != malloc_bump_end)
+      malloc_bump = region;
+    malloc_bump_end = region + MALLOC_HEAP_GROW;
+  }
+  malloc_header* header = (malloc_header*) malloc_bump;
+  malloc_bump += block_size;
+  return header;
+}
+
+static void* malloc_large(size_t size)
+{
+  size_t length = (size + sizeof(malloc_header) + MALLOC_PAGE_SIZE - 1) & ~(MALLOC_PAGE_SIZE - 1);
+  if (length < size || length & MALLOC_LARGE)
+    return 0;
+  malloc_header* header = mmap(0, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (header == MAP_FAILED)
+    return 0;
+  header->info = MALLOC_LARGE | length;
+  return header + 1;
+}
+
+/**
+ * returns the number of usable bytes of an allocated block
+ */
+static size_t malloc_usable_size(void* ptr)
+{
+  malloc_header* header = ((malloc_header*) ptr) - 1;
+  if (header->info & MALLOC_LARGE)
+    return (header->info & ~MALLOC_LARGE) - sizeof(malloc_header);
+  return malloc_class_sizes[header->info] - sizeof(malloc_header);
+}
 
 void *malloc(size_t size)
 {
-  return 0;
+  if (size > MALLOC_MAX_SMALL - sizeof(malloc_header))
+    return malloc_large(size);
+  if (!malloc_initialized)
+    malloc_init();
+
+  size_t size_class = malloc_class_of[(size + sizeof(malloc_header) + 15) / 16];
+  malloc_header* header = (malloc_header*) malloc_bins[size_class];
+  if (header)
+    malloc_bins[size_class] = malloc_bins[size_class]->next;
+  else if (!(header = malloc_refill(size_class)))
+    return 0;
+  header->info = size_class;
+  return header + 1;
 }
 
 void free(void *ptr)
 {
+  if (!ptr)
+    return;
+  malloc_header* header = ((malloc_header*) ptr) - 1;
+  if (header->info & MALLOC_LARGE)
+  {
+    munmap(header, header->info & ~MALLOC_LARGE);
+    return;
+  }
+  malloc_free_block* block = (malloc_free_block*) header;
+  size_t size_class = header->info;
+  block->next = malloc_bins[size_class];
+  malloc_bins[size_class] = block;
 }
 
 int atexit(void (*function)(void))
@@ -16,10 +153,32 @@ int atexit(void (*function)(void))
 
 void *calloc(size_t nmemb, size_t size)
 {
-  return 0;
+  size_t total = nmemb * size;
+  if (size && total / size != nmemb)
+    return 0;
+  void* ptr = malloc(total);
+  // fresh mappings are zeroed by the kernel already
+  if (ptr && total <= MALLOC_MAX_SMALL - sizeof(malloc_header))
+    memset(ptr, 0, total);
+  return ptr;
 }
 
 void *realloc(void *ptr, size_t size)
 {
-  return 0;
+  if (!ptr)
+    return malloc(size);
+  if (!size)
+  {
+    free(ptr);
+    return 0;
+  }
+  size_t usable = malloc_usable_size(ptr);
+  if (size <= usable)
+    return ptr;
+  void* new_ptr = malloc(size);
+  if (!new_ptr)
+    return 0;
+  memcpy(new_ptr, ptr, usable);
+  free(ptr);
+  return new_ptr;
 }
@@ -1,22 +1,37 @@
 #include "unistd.h"
+#include "sys/syscall.h"
+#include "../../../common/include/kernel/syscall-definitions.h"
 
 
 /**
- * function stub
+ * Sets the end of the heap (program break) of the calling process.
  * posix compatible signature - do not change the signature!
+ *
+ * @param end_data_segment the new end of the heap
+ * @return 0 on success, -1 on failure
  */
 int brk(void *end_data_segment)
 {
-  return -1;
+  size_t end = __syscall(sc_brk, (size_t) end_data_segment, 0x00, 0x00, 0x00, 0x00);
+  return end == (size_t) end_data_segment ? 0 : -1;
 }
 
 /**
- * function stub
+ * Moves the end of the heap (program break) of the calling process.
  * posix compatible signature - do not change the signature!
+ *
+ * @param increment number of bytes to grow (or shrink) the heap by
+ * @return the previous end of the heap, (void*) -1 on failure
  */
 void* sbrk(intptr_t increment)
 {
-  return (void*) -1;
+  size_t old_end = __syscall(sc_brk, 0x00, 0x00, 0x00, 0x00, 0x00);
+  if (increment == 0)
+    return (void*) old_end;
+  size_t end = old_end + increment;
+  if (__syscall(sc_brk, end, 0x00, 0x00, 0x00, 0x00) != end)
+    return (void*) -1;
+  return (void*) old_end;
 }
 
 
@@ -0,0 +1,66 @@
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+#include "fcntl.h"
+
+/*
+ * checks dup, dup2 and the reuse of closed file descriptor numbers,
+ * the numbers 0 to 2 are reserved, dup2 refuses to replace them
+ */
+
+#define TEST_FILE "/usr/fds.sweb"
+#define UNUSED_FD 100
+#define DUP2_FD 20
+
+int failures = 0;
+
+void check(int condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("fds: %s failed\n", what);
+    ++failures;
+  }
+}
+
+int main()
+{
+  char expected[8];
+  char got[8];
+
+  int fd = open(TEST_FILE, O_RDONLY);
+  check(fd >= 3, "open");
+  if (fd < 0)
+    return 1;
+  check(read(fd, expected, 8) == 8, "read");
+  check(close(fd) == 0, "close");
+  check(close(fd) == -1, "close of a closed fd");
+  check(read(fd, got, 8) == -1, "read of a closed fd");
+
+  int reopened = open(TEST_FILE, O_RDONLY);
+  check(reopened == fd, "reuse of the lowest free number");
+
+  int copy = dup(reopened);
+  check(copy >= 3 && copy != reopened, "dup");
+  // both numbers share the file position
+  check(read(reopened, got, 4) == 4 && read(copy, got + 4, 4) == 4 && memcmp(got, expected, 8) == 0,
+        "shared file position after dup");
+  check(dup(UNUSED_FD) == -1, "dup of an unused number");
+  check(dup(-1) == -1, "dup of a negative number");
+
+  check(dup2(reopened, DUP2_FD) == DUP2_FD, "dup2");
+  check(dup2(reopened, DUP2_FD) == DUP2_FD, "dup2 onto the same file");
+  check(dup2(copy, DUP2_FD) == DUP2_FD, "dup2 onto a used number");
+  check(dup2(reopened, 1) == -1, "dup2 onto a reserved number");
+  check(dup2(UNUSED_FD, DUP2_FD + 1) == -1, "dup2 of an unused number");
+  check(dup2(reopened, 4096) == -1, "dup2 beyond the table");
+
+  // the file stays open as long as one number refers to it
+  check(close(reopened) == 0 && close(copy) == 0, "close of the duplicated numbers");
+  check(read(DUP2_FD, got, 1) == 1, "read after closing the other numbers");
+  check(close(DUP2_FD) == 0, "close of the last number");
+  check(read(DUP2_FD, got, 1) == -1, "read of the closed file");
+
+  printf("fds: %d checks failed\n", failures);
+  return failures;
+}
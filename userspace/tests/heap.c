@@ -0,0 +1,98 @@
+#include "stdio.h"
+#include "string.h"
+#include "stdlib.h"
+#include "unistd.h"
+
+/*
+ * checks the return values of brk, sbrk, malloc, free and realloc
+ */
+
+#define PAGE_SIZE 4096
+#define NUM_SMALL 64
+#define LARGE_SIZE (5 * PAGE_SIZE)
+
+int failures = 0;
+
+void check(int condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("heap: %s failed\n", what);
+    ++failures;
+  }
+}
+
+void check_brk()
+{
+  char* start = sbrk(0);
+  check(start != (char*) -1, "sbrk(0)");
+  check(sbrk(2 * PAGE_SIZE) == start, "sbrk growing the heap");
+  check(sbrk(0) == start + 2 * PAGE_SIZE, "break after growing");
+  start[0] = 1;
+  start[2 * PAGE_SIZE - 1] = 2;
+  check(start[0] == 1 && start[2 * PAGE_SIZE - 1] == 2, "writing the new heap");
+
+  check(brk(start + PAGE_SIZE) == 0, "brk shrinking the heap");
+  check(sbrk(0) == start + PAGE_SIZE, "break after shrinking");
+  check(brk(start + 2 * PAGE_SIZE) == 0, "brk growing the heap again");
+  // the page given back comes back zeroed
+  check(start[2 * PAGE_SIZE - 1] == 0, "content of a page given back");
+  check(brk(start) == 0, "brk back to the start");
+
+  check(brk((char*) PAGE_SIZE) == -1, "brk below the heap");
+  check(brk((char*) 0xC0000000) == -1, "brk into the kernel");
+  check(sbrk(0) == start, "break after failed brk calls");
+}
+
+void check_malloc()
+{
+  char* small[NUM_SMALL];
+  int i;
+  int ok = 1;
+  for (i = 0; i < NUM_SMALL; ++i)
+  {
+    small[i] = malloc(i * 16 + 1);
+    ok = ok && small[i] && (size_t) small[i] % 8 == 0;
+    if (small[i])
+      memset(small[i], i, i * 16 + 1);
+  }
+  check(ok, "small malloc");
+  for (i = 0; i < NUM_SMALL; ++i)
+    ok = ok && small[i] && small[i][0] == (char) i && small[i][i * 16] == (char) i;
+  check(ok, "small blocks do not overlap");
+  for (i = 0; i < NUM_SMALL; ++i)
+    free(small[i]);
+  free(0);
+
+  char* large = malloc(LARGE_SIZE);
+  check(large != 0, "large malloc");
+  if (large)
+  {
+    memset(large, 7, LARGE_SIZE);
+    check(large[LARGE_SIZE - 1] == 7, "writing a large block");
+    free(large);
+  }
+  check(malloc(0xF0000000) == 0, "malloc of more than the address space");
+
+  char* grown = realloc(0, 10);
+  check(grown != 0, "realloc of 0");
+  if (grown)
+  {
+    memcpy(grown, "realloced", 10);
+    grown = realloc(grown, 100);
+    check(grown && strcmp(grown, "realloced") == 0, "realloc to a small block");
+    grown = realloc(grown, LARGE_SIZE);
+    check(grown && strcmp(grown, "realloced") == 0, "realloc to a large block");
+    char* shrunk = realloc(grown, 20);
+    check(shrunk == grown, "realloc shrinking in place");
+    check(realloc(shrunk, 0) == 0, "realloc to 0");
+  }
+}
+
+int main()
+{
+  check_brk();
+  check_malloc();
+  printf("heap: %d checks failed\n", failures);
+  return failures;
+}
@@ -0,0 +1,78 @@
+#include "stdio.h"
+#include "string.h"
+#include "unistd.h"
+#include "fcntl.h"
+#include "sys/mman.h"
+
+/*
+ * checks the return values of mmap, munmap and msync for anonymous and file
+ * mappings
+ */
+
+#define TEST_FILE "/usr/mmap.sweb"
+#define PAGE_SIZE 4096
+#define NUM_PAGES 4
+
+int failures = 0;
+
+void check(int condition, const char* what)
+{
+  if (!condition)
+  {
+    printf("mmap: %s failed\n", what);
+    ++failures;
+  }
+}
+
+int main()
+{
+  char expected[64];
+  int i;
+
+  char* anonymous = mmap(0, NUM_PAGES * PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  check(anonymous != MAP_FAILED && (size_t) anonymous % PAGE_SIZE == 0, "anonymous mmap");
+  if (anonymous != MAP_FAILED)
+  {
+    int zero = 1;
+    for (i = 0; i < NUM_PAGES * PAGE_SIZE; ++i)
+      zero = zero && anonymous[i] == 0;
+    check(zero, "anonymous memory is zero");
+    for (i = 0; i < NUM_PAGES; ++i)
+      anonymous[i * PAGE_SIZE] = i + 1;
+    check(anonymous[(NUM_PAGES - 1) * PAGE_SIZE] == NUM_PAGES, "writing anonymous memory");
+    check(msync(anonymous, NUM_PAGES * PAGE_SIZE, MS_SYNC) == 0, "msync of anonymous memory");
+    check(munmap(anonymous + PAGE_SIZE, PAGE_SIZE) == 0, "munmap of a page in the middle");
+    check(anonymous[0] == 1 && anonymous[2 * PAGE_SIZE] == 3, "pages around an unmapped page");
+    check(munmap(anonymous, NUM_PAGES * PAGE_SIZE) == 0, "munmap of a range with a hole");
+  }
+
+  check(mmap(0, 0, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0) == MAP_FAILED, "mmap of length 0");
+  check(mmap(0, PAGE_SIZE, PROT_READ, MAP_PRIVATE, 100, 0) == MAP_FAILED, "mmap of an unused fd");
+  check(munmap(anonymous + 1, PAGE_SIZE) == -1, "munmap of an unaligned address");
+  check(munmap(anonymous, 0) == -1, "munmap of length 0");
+  check(msync(anonymous + 1, PAGE_SIZE, MS_SYNC) == -1, "msync of an unaligned address");
+  check(msync(anonymous, PAGE_SIZE, 0x100) == -1, "msync with unknown flags");
+
+  int fd = open(TEST_FILE, O_RDONLY);
+  check(fd >= 0, "open");
+  if (fd < 0)
+    return 1;
+  check(read(fd, expected, sizeof(expected)) == sizeof(expected), "read");
+  check(mmap(0, PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED,
+        "writable shared mmap of a read only file");
+  check(mmap(0, PAGE_SIZE, PROT_READ, MAP_PRIVATE, fd, 1) == MAP_FAILED, "mmap of an unaligned offset");
+
+  char* file = mmap(0, PAGE_SIZE, PROT_READ, MAP_SHARED, fd, 0);
+  check(file != MAP_FAILED, "file mmap");
+  // the mapping keeps the file, closing the descriptor does not end it
+  check(close(fd) == 0, "close");
+  if (file != MAP_FAILED)
+  {
+    check(memcmp(file, expected, sizeof(expected)) == 0, "content of the file mapping");
+    check(msync(file, PAGE_SIZE, MS_SYNC) == 0, "msync of the file mapping");
+    check(munmap(file, PAGE_SIZE) == 0, "munmap of the file mapping");
+  }
+
+  printf("mmap: %d checks failed\n", failures);
+  return failures;
+}
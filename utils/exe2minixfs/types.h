@@ -31,6 +31,9 @@ typedef void* pointer;
 
 typedef uint64_t l_off_t;
 
+#define Min(x,y) (((x)<(y))?(x):(y))
+#define Max(x,y) (((x)>(y))?(x):(y))
+
 class FileSystemInfo;
 
 class FakeThread { public: FileSystemInfo* getWorkingDirInfo() { return 0; } };